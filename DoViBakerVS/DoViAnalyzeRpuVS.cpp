@@ -0,0 +1,69 @@
+#include "DoViAnalyzeRpuVS.h"
+#include "DoViRpuAnalyzer.h"
+#include <string>
+
+static void setIntRange(const VSAPI* vsapi, VSMap* out, const char* key, const uint16_t range[2])
+{
+    const int64_t values[2] = { range[0], range[1] };
+    vsapi->mapSetIntArray(out, key, values, 2);
+}
+
+void VS_CC DoViAnalyzeRpuVS::create(const VSMap* in, VSMap* out, void*, VSCore*, const VSAPI* vsapi)
+{
+    int error = 0;
+    const char* rpuPath = vsapi->mapGetData(in, "rpu", 0, &error);
+    if (error || !rpuPath || !rpuPath[0]) {
+        vsapi->mapSetError(out, "DoViAnalyzeRpu: rpu must be given");
+        return;
+    }
+    const int threads = static_cast<int>(vsapi->mapGetInt(in, "threads", 0, &error));
+
+    const DoviRpuOpaqueList* rpus = dovi_parse_rpu_bin_file(rpuPath);
+    if (!rpus) {
+        vsapi->mapSetError(out, "DoViAnalyzeRpu: cannot parse RPU file");
+        return;
+    }
+    DoViRpuSummary summary = DoViRpuAnalyzer::analyze(rpus, error ? 0 : threads);
+    dovi_rpu_list_free(rpus);
+
+    if (!summary.error.empty()) {
+        vsapi->mapSetError(out, (std::string("DoViAnalyzeRpu: ") + summary.error).c_str());
+        return;
+    }
+
+    vsapi->mapSetInt(out, "frames", summary.frames, maReplace);
+    vsapi->mapSetInt(out, "profile", summary.profile, maReplace);
+    vsapi->mapSetData(out, "el_type", summary.elType.c_str(), static_cast<int>(summary.elType.size()), dtUtf8, maReplace);
+    vsapi->mapSetInt(out, "profile_varies", summary.profileVaries ? 1 : 0, maReplace);
+    vsapi->mapSetInt(out, "el_type_varies", summary.elTypeVaries ? 1 : 0, maReplace);
+    vsapi->mapSetInt(out, "residual_frames", summary.residualFrames, maReplace);
+    vsapi->mapSetInt(out, "identity_mapping_frames", summary.identityMappingFrames, maReplace);
+    vsapi->mapSetInt(out, "poly_mapping_frames", summary.polyMappingFrames, maReplace);
+    vsapi->mapSetInt(out, "mmr_mapping_frames", summary.mmrMappingFrames, maReplace);
+
+    vsapi->mapSetInt(out, "scenes", static_cast<int64_t>(summary.sceneCuts.size()), maReplace);
+    std::vector<int64_t> sceneCuts(summary.sceneCuts.begin(), summary.sceneCuts.end());
+    vsapi->mapSetIntArray(out, "scene_cuts", sceneCuts.data(), static_cast<int>(sceneCuts.size()));
+
+    if (summary.hasL1) {
+        setIntRange(vsapi, out, "l1_min_pq", summary.l1MinPq);
+        setIntRange(vsapi, out, "l1_max_pq", summary.l1MaxPq);
+        setIntRange(vsapi, out, "l1_avg_pq", summary.l1AvgPq);
+    }
+
+    std::vector<int64_t> trimPqs(summary.l2TargetPqs.begin(), summary.l2TargetPqs.end());
+    vsapi->mapSetIntArray(out, "l2_trim_pqs", trimPqs.data(), static_cast<int>(trimPqs.size()));
+
+    if (summary.hasL5) {
+        const int64_t offsets[4] = { summary.l5Offsets[0], summary.l5Offsets[1], summary.l5Offsets[2], summary.l5Offsets[3] };
+        vsapi->mapSetIntArray(out, "l5_offsets", offsets, 4);
+        vsapi->mapSetInt(out, "l5_varies", summary.l5Varies ? 1 : 0, maReplace);
+    }
+
+    if (summary.hasL6) {
+        setIntRange(vsapi, out, "l6_max_cll", summary.l6MaxCll);
+        setIntRange(vsapi, out, "l6_max_fall", summary.l6MaxFall);
+        setIntRange(vsapi, out, "l6_master_display_max_luminance", summary.l6MasterMaxLuminance);
+        setIntRange(vsapi, out, "l6_master_display_min_luminance", summary.l6MasterMinLuminance);
+    }
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include "VapourSynth4++.hpp"
+
+using namespace vsxx4;
+
+// Plain function (no clip involved): scans an RPU.bin and returns a dict summarizing the whole stream
+class DoViAnalyzeRpuVS {
+public:
+    static void VS_CC create(const VSMap* in, VSMap* out, void* userData, VSCore* core, const VSAPI* vsapi);
+};
@@ -1,8 +1,20 @@
 #include "DoViBakerVS.h"
+#include "DoViStripEngine.h"
+#include "DoViScratchArena.h"
+#include "DoViKernels.h"
+#include "DoViPqMath.h"
+#include "DoViDither.h"
+#include "DoViRpuAnalyzer.h"
 #include "VSHelper4.h"
 #include <stdexcept>
 #include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
 #include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
 #include <thread>
 
 // Get pool size based on hardware concurrency
@@ -13,17 +25,120 @@ static int getPoolSize() {
     return std::min(32, std::max(4, hwThreads));
 }
 
-DoViBakerVS::DoViBakerVS(void*)
+// Columns rendered beyond the active area, they cover the reach of the filter taps from the edges of the rendered view
+static constexpr int activeAreaMargin = 16;
+
+// Float value of every 16 bit RGB code. Limited range is expanded to full range, as usual for float formats.
+// Linear light is normalized to 10000 nits, below black it is clipped.
+static std::vector<float> buildFloatLut(bool limitedRange, bool linear)
+{
+    std::vector<float> lut(65536);
+    const float* eotf = DoViPqMath::eotfTable16();
+    for (int code = 0; code < 65536; code++) {
+        if (!limitedRange) {
+            lut[code] = linear ? eotf[code] : code / 65535.0f;
+            continue;
+        }
+        const float ep = (code - (16 << 8)) / float((235 - 16) << 8);
+        lut[code] = linear ? DoViPqMath::eotf(std::max(ep, 0.0f)) : ep;
+    }
+    return lut;
+}
+
+// Full range code of every limited range 16 bit code, clipped below black and above white,
+// with one padding entry for the vectorized lookup
+static std::vector<uint16_t> buildMeasureLut()
+{
+    std::vector<uint16_t> lut(65537, 0);
+    for (int code = 0; code < 65536; code++) {
+        const int64_t full = (int64_t(code - (16 << 8)) * 65535 + ((235 - 16) << 7)) / ((235 - 16) << 8);
+        lut[code] = static_cast<uint16_t>(std::clamp<int64_t>(full, 0, 65535));
+    }
+    return lut;
+}
+
+// IEEE half float with round to nearest even, like the F16C conversion
+static uint16_t floatToHalf(float value)
+{
+    uint32_t f;
+    std::memcpy(&f, &value, sizeof(f));
+    const uint32_t sign = f & 0x80000000u;
+    f ^= sign;
+
+    uint32_t h;
+    if (f >= (143u << 23)) {
+        // overflow to infinity, NaN stays NaN
+        h = f > (255u << 23) ? 0x7E00 : 0x7C00;
+    } else if (f < (113u << 23)) {
+        // subnormal or zero, the float addition does the rounding
+        const uint32_t magicBits = 126u << 23;
+        float magic;
+        std::memcpy(&magic, &magicBits, sizeof(magic));
+        float sum;
+        std::memcpy(&sum, &f, sizeof(sum));
+        sum += magic;
+        std::memcpy(&h, &sum, sizeof(h));
+        h -= magicBits;
+    } else {
+        const uint32_t mantissaOdd = (f >> 13) & 1;
+        f += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF;
+        f += mantissaOdd;
+        h = f >> 13;
+    }
+    return static_cast<uint16_t>(h | (sign >> 16));
+}
+
+DoViBakerVS::DoViBakerVS(void* userData)
     : m_vi{}
     , m_blVi{}
     , m_elVi{}
     , m_qnd(false)
+    , m_preview(false)
     , m_outYUV(false)
     , m_blChromaSubSampled(false)
     , m_elChromaSubSampled(false)
     , m_quarterResolutionEl(false)
     , m_hasEl(false)
 {
+    if (const auto* output = static_cast<const DoViBakerMultiOutput*>(userData)) {
+        m_composeCache = output->cache;
+        m_outputIndex = output->index;
+    }
+}
+
+void VS_CC DoViBakerVS::createMulti(const VSMap* in, VSMap* out, void*, VSCore* core, const VSAPI* vsapi)
+{
+    // as many outputs as the longest per output argument has elements
+    static const char* const outputKeys[] = {
+        "trimPq", "targetMaxNits", "targetMinNits", "outYUV", "outFloat", "outLinear", "tonemapMaxNits",
+        "tonemapMinNits", "masterMaxNits", "masterMinNits", "lumScale", "kneeOffset", "normalizeOutput", "measure",
+        "outDepth", "dither",
+    };
+    int outputs = 1;
+    for (const char* key : outputKeys) {
+        outputs = std::max(outputs, vsapi->mapNumElements(in, key));
+    }
+
+    // an output may run a few frames ahead of the others, the cache holds about two frames per thread
+    const size_t capacity = std::max<size_t>(8, 2 * std::thread::hardware_concurrency());
+    auto cache = std::make_shared<DoViComposeCache>(outputs, capacity);
+    for (int i = 0; i < outputs; i++) {
+        DoViBakerMultiOutput output{ cache, i };
+        FilterBase::filter_create<DoViBakerVS>(in, out, &output, core, vsapi);
+        if (vsapi->mapGetError(out)) {
+            return;
+        }
+    }
+}
+
+template <typename T>
+T DoViBakerVS::getOutputProp(const ConstMap& in, const char* key, T defaultValue) const
+{
+    const int count = in.num_elements(key);
+    if (count <= 0) {
+        return defaultValue;
+    }
+    return in.get_prop<T>(key, std::min(m_outputIndex, count - 1));
 }
 
 DoViBakerVS::~DoViBakerVS()
@@ -53,6 +168,15 @@ void DoViBakerVS::releaseProcessor(DoViProcessor* proc)
     m_poolCV.notify_one();
 }
 
+void DoViBakerVS::forEachStripe(int count, int align, int minRows, const std::function<void(int, int)>& fn) const
+{
+    if (m_scheduler) {
+        m_scheduler->parallelFor(count, align, minRows, fn);
+    } else {
+        fn(0, count);
+    }
+}
+
 void DoViBakerVS::init(const ConstMap& in, const Map& out, const Core& core)
 {
     // Get base layer clip (required)
@@ -100,18 +224,74 @@ void DoViBakerVS::init(const ConstMap& in, const Map& out, const Core& core)
     }
 
     // Get parameters and save for pool processor creation
-    m_trimPq = static_cast<uint16_t>(in.get_prop<int64_t>("trimPq", map::default_val(0LL)));
-    m_targetMaxNits = static_cast<float>(in.get_prop<double>("targetMaxNits", map::default_val(100.0)));
-    m_targetMinNits = static_cast<float>(in.get_prop<double>("targetMinNits", map::default_val(0.0)));
+    m_trimPq = static_cast<uint16_t>(getOutputProp<int64_t>(in, "trimPq", 0));
+    m_targetMaxNits = static_cast<float>(getOutputProp<double>(in, "targetMaxNits", 100.0));
+    m_targetMinNits = static_cast<float>(getOutputProp<double>(in, "targetMinNits", 0.0));
     m_qnd = in.get_prop<int64_t>("qnd", map::default_val(0LL)) != 0;
+    m_preview = in.get_prop<int64_t>("preview", map::default_val(0LL)) != 0;
     m_rgbProof = in.get_prop<int64_t>("rgbProof", map::default_val(0LL)) != 0;
     m_nlqProof = in.get_prop<int64_t>("nlqProof", map::default_val(0LL)) != 0;
-    m_outYUV = in.get_prop<int64_t>("outYUV", map::default_val(0LL)) != 0;
+    m_outYUV = getOutputProp<int64_t>(in, "outYUV", 0) != 0;
+    m_outFloat = static_cast<int>(getOutputProp<int64_t>(in, "outFloat", 0));
+    m_outLinear = getOutputProp<int64_t>(in, "outLinear", 0) != 0;
+    m_measure = getOutputProp<int64_t>(in, "measure", 0) != 0;
+    m_outDepth = static_cast<int>(getOutputProp<int64_t>(in, "outDepth", 16));
+    const int dither = static_cast<int>(getOutputProp<int64_t>(in, "dither", DoViDither::blueNoise));
+    const bool cropActiveArea = in.get_prop<int64_t>("cropActiveArea", map::default_val(0LL)) != 0;
+    m_activeArea = cropActiveArea || in.get_prop<int64_t>("activeArea", map::default_val(0LL)) != 0;
+
+    const float tonemapMaxNits = static_cast<float>(getOutputProp<double>(in, "tonemapMaxNits", 0.0));
+    m_tonemap = tonemapMaxNits > 0;
+    if (m_tonemap) {
+        const float tonemapMinNits = static_cast<float>(getOutputProp<double>(in, "tonemapMinNits", 0.0));
+        const float masterMaxNits = static_cast<float>(getOutputProp<double>(in, "masterMaxNits", -1.0));
+        const float masterMinNits = static_cast<float>(getOutputProp<double>(in, "masterMinNits", -1.0));
+        const uint16_t targetMaxPq = DoViProcessor::nits2pq(tonemapMaxNits);
+        const uint16_t targetMinPq = DoViProcessor::nits2pq(tonemapMinNits);
+        m_tmMasterMaxPq = masterMaxNits < 0 ? -1 : DoViProcessor::nits2pq(masterMaxNits);
+        m_tmMasterMinPq = masterMinNits < 0 ? -1 : DoViProcessor::nits2pq(masterMinNits);
+        m_tmLumScale = static_cast<float>(getOutputProp<double>(in, "lumScale", 1.0));
+        const float kneeOffset = static_cast<float>(getOutputProp<double>(in, "kneeOffset", 0.75));
+        const bool normalizeOutput = getOutputProp<int64_t>(in, "normalizeOutput", 0) != 0;
+
+        if (targetMinPq * 2 > targetMaxPq) {
+            throw std::runtime_error("DoViBaker: Value for 'tonemapMinNits' is too large to process");
+        }
+        if (m_tmMasterMaxPq >= 0 && m_tmMasterMinPq >= 0 && m_tmMasterMaxPq <= m_tmMasterMinPq) {
+            throw std::runtime_error("DoViBaker: master capabilities given are invalid");
+        }
+        if (m_tmLumScale <= 0) {
+            throw std::runtime_error("DoViBaker: lumScale must be positive");
+        }
+        m_eetfCache = std::make_unique<DoViEetfCache<16>>(targetMaxPq, targetMinPq, kneeOffset, normalizeOutput);
+    }
     m_sourceProfile = static_cast<int>(in.get_prop<int64_t>("sourceProfile", map::default_val(0LL)));
 
-    // Validate sourceProfile (must be 0, 7, or 8)
-    if (m_sourceProfile != 0 && m_sourceProfile != 7 && m_sourceProfile != 8) {
-        throw std::runtime_error("DoViBaker: sourceProfile must be 0 (auto), 7, or 8");
+    const int64_t rpuConvertMode = in.get_prop<int64_t>("rpuConvertMode", map::default_val(0LL));
+    if (rpuConvertMode < 0 || rpuConvertMode > 4) {
+        throw std::runtime_error("DoViBaker: rpuConvertMode must be between 0 and 4");
+    }
+    m_rpuConvertMode = static_cast<uint8_t>(rpuConvertMode);
+    m_rpuRemoveMapping = in.get_prop<int64_t>("rpuRemoveMapping", map::default_val(0LL)) != 0;
+    m_rpuReplaceProp = m_rpuConvertMode != 0 || m_rpuRemoveMapping;
+
+    int threads = static_cast<int>(in.get_prop<int64_t>("threads", map::default_val(1LL)));
+    if (threads < 0) {
+        throw std::runtime_error("DoViBaker: threads must not be negative");
+    }
+    if (threads == 0) {
+        threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    if (threads > 1) {
+        m_scheduler = std::make_unique<DoViStripeScheduler>(threads);
+    }
+
+    // Validate sourceProfile (must be 0, 5, 7, or 8)
+    if (m_sourceProfile != 0 && m_sourceProfile != 5 && m_sourceProfile != 7 && m_sourceProfile != 8) {
+        throw std::runtime_error("DoViBaker: sourceProfile must be 0 (auto), 5, 7, or 8");
+    }
+    if (m_sourceProfile == 5 && m_outYUV) {
+        throw std::runtime_error("DoViBaker: outYUV cannot be used with profile 5 (IPT) input");
     }
 
     // Validate outYUV restrictions (matching quietvoid fork behavior)
@@ -125,6 +305,82 @@ void DoViBakerVS::init(const ConstMap& in, const Map& out, const Core& core)
         if (m_rgbProof) {
             throw std::runtime_error("DoViBaker: rgbProof cannot be used when outYUV=true");
         }
+        if (m_outFloat) {
+            throw std::runtime_error("DoViBaker: outFloat cannot be used when outYUV=true");
+        }
+        if (m_tonemap) {
+            throw std::runtime_error("DoViBaker: tonemapMaxNits cannot be used when outYUV=true");
+        }
+        if (in.contains("cubes")) {
+            throw std::runtime_error("DoViBaker: cubes cannot be used when outYUV=true");
+        }
+        if (m_activeArea) {
+            throw std::runtime_error("DoViBaker: activeArea cannot be used when outYUV=true");
+        }
+        if (m_measure) {
+            throw std::runtime_error("DoViBaker: measure cannot be used when outYUV=true");
+        }
+        if (m_outDepth != 16) {
+            throw std::runtime_error("DoViBaker: outDepth cannot be used when outYUV=true");
+        }
+    }
+    if (m_preview) {
+        if (m_outYUV) {
+            throw std::runtime_error("DoViBaker: preview cannot be used when outYUV=true");
+        }
+        if (m_qnd) {
+            throw std::runtime_error("DoViBaker: preview cannot be used together with qnd");
+        }
+        if (m_activeArea) {
+            throw std::runtime_error("DoViBaker: preview cannot be used together with activeArea");
+        }
+    }
+
+    if (m_outFloat != 0 && m_outFloat != 16 && m_outFloat != 32) {
+        throw std::runtime_error("DoViBaker: outFloat must be 0 (integer), 16 (half float) or 32 (float)");
+    }
+    if (m_outLinear && !m_outFloat) {
+        throw std::runtime_error("DoViBaker: outLinear requires outFloat");
+    }
+    if (in.contains("upsampler")) {
+        const std::string upsampler = in.get_prop<const char*>("upsampler");
+        if (upsampler == "nearest") {
+            m_upsampler = DoViUpsampler::nearest;
+        } else if (upsampler == "bilinear") {
+            m_upsampler = DoViUpsampler::bilinear;
+        } else if (upsampler != "spline16") {
+            throw std::runtime_error("DoViBaker: upsampler must be nearest, bilinear or spline16");
+        }
+        if (m_qnd) {
+            throw std::runtime_error("DoViBaker: upsampler cannot be used together with qnd");
+        }
+    }
+    if (m_outDepth != 8 && m_outDepth != 10 && m_outDepth != 12 && m_outDepth != 16) {
+        throw std::runtime_error("DoViBaker: outDepth must be 8, 10, 12 or 16");
+    }
+    if (dither < DoViDither::none || dither > DoViDither::blueNoise) {
+        throw std::runtime_error("DoViBaker: dither must be 0 (none), 1 (ordered) or 2 (blue noise)");
+    }
+    if (m_outDepth != 16) {
+        if (m_outFloat) {
+            throw std::runtime_error("DoViBaker: outDepth cannot be used together with outFloat");
+        }
+        m_ditherThresholds = DoViDither::thresholds(static_cast<DoViDither::Type>(dither), 16 - m_outDepth);
+    }
+    if (m_measure) {
+        m_measureLut = buildMeasureLut();
+    }
+    if (m_outFloat) {
+        for (int limited = 0; limited < 2; limited++) {
+            std::vector<float> lut = buildFloatLut(limited, m_outLinear);
+            if (m_outFloat == 32) {
+                m_floatLut[limited] = std::move(lut);
+            } else {
+                // one padding entry for the vectorized lookup
+                m_halfLut[limited].resize(65537, 0);
+                std::transform(lut.begin(), lut.end(), m_halfLut[limited].begin(), floatToHalf);
+            }
+        }
     }
 
     // Save container bits for pool creation
@@ -141,6 +397,18 @@ void DoViBakerVS::init(const ConstMap& in, const Map& out, const Core& core)
     if (!firstProc->isIntegratedRpu() && m_blVi.numFrames != firstProc->getClipLength()) {
         throw std::runtime_error("DoViBaker: Clip length does not match length indicated by RPU file");
     }
+    // the composition of IPT input is no YCbCr that could be passed on, integrated RPUs are checked per frame
+    if (m_outYUV && firstProc->hasIptInput()) {
+        throw std::runtime_error("DoViBaker: outYUV cannot be used with profile 5 (IPT) input");
+    }
+
+    if (in.contains("rpuOut")) {
+        std::string error;
+        m_rpuWriter = std::make_unique<DoViRpuWriter>();
+        if (!m_rpuWriter->open(in.get_prop<const char*>("rpuOut"), m_blVi.numFrames, error)) {
+            throw std::runtime_error("DoViBaker: " + error);
+        }
+    }
 
     // Get the shared RPU data from the first processor
     m_sharedRpus = firstProc->getRpuList();
@@ -169,15 +437,96 @@ void DoViBakerVS::init(const ConstMap& in, const Map& out, const Core& core)
         m_processors.push_back(std::move(proc));
     }
 
+    // Crop to the union of the active areas of all frames
+    if (cropActiveArea) {
+        if (!rpuPath) {
+            throw std::runtime_error("DoViBaker: cropActiveArea requires an RPU file");
+        }
+        const DoViRpuSummary summary = DoViRpuAnalyzer::analyze(m_sharedRpus);
+        if (!summary.error.empty()) {
+            throw std::runtime_error("DoViBaker: " + summary.error);
+        }
+        if (summary.hasL5) {
+            std::copy_n(summary.l5Offsets, 4, m_crop.begin());
+        }
+        if (m_crop[0] + m_crop[1] >= m_blVi.width || m_crop[2] + m_crop[3] >= m_blVi.height) {
+            throw std::runtime_error("DoViBaker: L5 active area is empty");
+        }
+    }
+
     // Set output format based on outYUV parameter
     m_vi = m_blVi;
+    m_vi.width -= m_crop[0] + m_crop[1];
+    m_vi.height -= m_crop[2] + m_crop[3];
+    if (m_preview) {
+        // composed on the grid of the 4:2:0 chroma
+        m_vi.width = (m_vi.width + 1) >> 1;
+        m_vi.height = (m_vi.height + 1) >> 1;
+    }
+
+    // Resize to outWidth x outHeight, a missing one follows the aspect ratio of the (cropped) source
+    int outWidth = static_cast<int>(in.get_prop<int64_t>("outWidth", map::default_val(0LL)));
+    int outHeight = static_cast<int>(in.get_prop<int64_t>("outHeight", map::default_val(0LL)));
+    if (outWidth < 0 || outHeight < 0) {
+        throw std::runtime_error("DoViBaker: outWidth and outHeight must not be negative");
+    }
+    if (outWidth || outHeight) {
+        if (outWidth == 0) {
+            outWidth = std::max(2, static_cast<int>(std::lround(0.5 * m_vi.width * outHeight / m_vi.height)) * 2);
+        }
+        if (outHeight == 0) {
+            outHeight = std::max(2, static_cast<int>(std::lround(0.5 * m_vi.height * outWidth / m_vi.width)) * 2);
+        }
+    }
+    if ((outWidth && outWidth != m_vi.width) || (outHeight && outHeight != m_vi.height)) {
+        if (m_outYUV) {
+            throw std::runtime_error("DoViBaker: outWidth / outHeight cannot be used when outYUV=true");
+        }
+        if (m_qnd) {
+            throw std::runtime_error("DoViBaker: outWidth / outHeight cannot be used together with qnd");
+        }
+        if (m_preview) {
+            throw std::runtime_error("DoViBaker: outWidth / outHeight cannot be used together with preview");
+        }
+        const char* kernel = in.contains("resizeKernel") ? in.get_prop<const char*>("resizeKernel") : "spline36";
+        m_resampler = std::make_unique<DoViResampler>(m_vi.width, m_vi.height, outWidth, outHeight, kernel);
+        m_vi.width = outWidth;
+        m_vi.height = outHeight;
+    }
     if (m_outYUV) {
         // YUV output - preserve input chroma subsampling
         m_vi.format = core.query_video_format(cfYUV, stInteger, 16,
             m_blChromaSubSampled ? 1 : 0, m_blChromaSubSampled ? 1 : 0);
+    } else if (m_outFloat) {
+        // RGBS or RGBH
+        m_vi.format = core.query_video_format(cfRGB, stFloat, m_outFloat, 0, 0);
     } else {
-        // RGB48 output (16-bit planar RGB)
-        m_vi.format = core.query_video_format(cfRGB, stInteger, 16, 0, 0);
+        // RGB48 output (16-bit planar RGB), or RGB30 / RGB24 and the like dithered down to outDepth
+        m_vi.format = core.query_video_format(cfRGB, stInteger, m_outDepth, 0, 0);
+    }
+
+    if (in.contains("cubes")) {
+        if (m_outFloat) {
+            throw std::runtime_error("DoViBaker: cubes cannot be used together with outFloat");
+        }
+        m_cubesFullrange = in.get_prop<int64_t>("cubesFullrange", map::default_val(1LL)) != 0;
+
+        // the cubes take the 16 bit RGB as full range, like DoViCubes does, and process single rows
+        timecube_filter_params params{};
+        params.width = static_cast<unsigned>(m_vi.width);
+        params.height = 1;
+        params.src_type = TIMECUBE_PIXEL_WORD;
+        params.src_depth = 16;
+        params.src_range = TIMECUBE_RANGE_FULL;
+        params.dst_type = TIMECUBE_PIXEL_WORD;
+        params.dst_depth = 16;
+        params.dst_range = m_cubesFullrange ? TIMECUBE_RANGE_FULL : TIMECUBE_RANGE_LIMITED;
+        params.interp = TIMECUBE_INTERP_TETRA;
+        params.cpu = static_cast<timecube_cpu_type_e>(INT_MAX);
+        m_cubes = std::make_unique<DoViCubeSet>(in, params, "DoViBaker");
+    }
+    if (in.contains("cacheDir")) {
+        m_diskCache = std::make_unique<DoViDiskCache>(in.get_prop<const char*>("cacheDir"), cacheKey(in, rpuPath));
     }
 
     // Register filter - now safe to use fmParallel with processor pool
@@ -205,6 +554,9 @@ ConstFrame DoViBakerVS::get_frame(int n, const Core& core, const FrameContext& f
 
     Frame dst = core.new_video_frame(m_vi.format, m_vi.width, m_vi.height, blSrc);
 
+    // BakerMulti: every way out of here releases this output's claim on the shared composition
+    DoViComposeClaim composeClaim(m_composeCache.get(), n);
+
     // Acquire a processor from the pool (RAII - automatically released when lease goes out of scope)
     DoViProcessorLease proc(*const_cast<DoViBakerVS*>(this));
 
@@ -236,8 +588,34 @@ ConstFrame DoViBakerVS::get_frame(int n, const Core& core, const FrameContext& f
     // Initialize DoViProcessor for this frame
     bool doviInitialized = proc->intializeFrame(n, nullptr, rpubuf, rpusize);
     if (!doviInitialized) {
+        if (m_rpuWriter) {
+            m_rpuWriter->fail(n);
+        }
         return dst;
     }
+    // integrated RPUs only tell the profile per frame, RPU files are checked in init
+    if (m_outYUV && proc->isIntegratedRpu() && proc->isIptInput()) {
+        throw std::runtime_error("DoViBaker: outYUV cannot be used with profile 5 (IPT) input");
+    }
+
+    // Re-emit the (converted) RPU alongside the frame
+    if (m_rpuReplaceProp || m_rpuWriter) {
+        std::vector<uint8_t> nalu;
+        std::string error;
+        if (!DoViRpuWriter::convert(m_sharedRpus, n, rpubuf, rpusize, m_rpuConvertMode, m_rpuRemoveMapping, nalu, error)) {
+            if (m_rpuWriter) {
+                m_rpuWriter->fail(n);
+            }
+            throw std::runtime_error("DoViBaker: RPU conversion failed on frame " + std::to_string(n) + ": " + error);
+        }
+        if (m_rpuReplaceProp) {
+            get_vsapi()->mapSetData(dst.frame_props_rw().get(), "DolbyVisionRPU",
+                reinterpret_cast<const char*>(nalu.data()), static_cast<int>(nalu.size()), dtBinary, maReplace);
+        }
+        if (m_rpuWriter) {
+            m_rpuWriter->write(n, std::move(nalu));
+        }
+    }
 
     // Set frame properties
     if (m_outYUV) {
@@ -246,10 +624,20 @@ ConstFrame DoViBakerVS::get_frame(int n, const Core& core, const FrameContext& f
         dst.frame_props_rw().set_prop("_ColorRange", static_cast<int64_t>(1));  // Limited range
         dst.frame_props_rw().set_prop("_Primaries", static_cast<int64_t>(9));   // BT.2020
         dst.frame_props_rw().set_prop("_Transfer", static_cast<int64_t>(16));   // PQ (SMPTE ST 2084)
+    } else if (m_outFloat) {
+        // float RGB output is always full range
+        dst.frame_props_rw().set_prop("_Matrix", static_cast<int64_t>(0));
+        dst.frame_props_rw().set_prop("_ColorRange", static_cast<int64_t>(0));
+        dst.frame_props_rw().set_prop("_Primaries", static_cast<int64_t>(9));                     // BT.2020
+        dst.frame_props_rw().set_prop("_Transfer", static_cast<int64_t>(m_outLinear ? 8 : 16));  // linear or PQ
+    } else if (m_cubes) {
+        // RGB output in the range of the cubes
+        dst.frame_props_rw().set_prop("_Matrix", static_cast<int64_t>(0));
+        dst.frame_props_rw().set_prop("_ColorRange", static_cast<int64_t>(m_cubesFullrange ? 0 : 1));
     } else {
-        // RGB output
+        // RGB output, the EETF of the tonemapping always outputs full range
         dst.frame_props_rw().set_prop("_Matrix", static_cast<int64_t>(0));
-        dst.frame_props_rw().set_prop("_ColorRange", static_cast<int64_t>(proc->isLimitedRangeOutput() ? 1 : 0));
+        dst.frame_props_rw().set_prop("_ColorRange", static_cast<int64_t>(proc->isLimitedRangeOutput() && !m_tonemap ? 1 : 0));
     }
     dst.frame_props_rw().set_prop("_SceneChangePrev", static_cast<int64_t>(proc->isSceneChange() ? 1 : 0));
     dst.frame_props_rw().set_prop("_dovi_dynamic_min_pq", static_cast<int64_t>(proc->getDynamicMinPq()));
@@ -261,586 +649,345 @@ ConstFrame DoViBakerVS::get_frame(int n, const Core& core, const FrameContext& f
     dst.frame_props_rw().set_prop("_dovi_static_master_display_max_luminance", static_cast<int64_t>(proc->getStaticMasterDisplayMaxLuminance()));
     dst.frame_props_rw().set_prop("_dovi_static_master_display_min_luminance", static_cast<int64_t>(proc->getStaticMasterDisplayMinLuminance()));
 
-    // Process using quick and dirty mode (for now, implement full quality mode later)
-    if (m_qnd) {
-        if (m_blChromaSubSampled && m_elChromaSubSampled) {
-            if (m_quarterResolutionEl)
-                doAllQuickAndDirty<true, true, true>(dst, blSrc, elSrc, *proc);
-            else
-                doAllQuickAndDirty<true, true, false>(dst, blSrc, elSrc, *proc);
-        } else if (m_blChromaSubSampled && !m_elChromaSubSampled) {
-            if (m_quarterResolutionEl)
-                doAllQuickAndDirty<true, false, true>(dst, blSrc, elSrc, *proc);
-            else
-                doAllQuickAndDirty<true, false, false>(dst, blSrc, elSrc, *proc);
-        } else if (!m_blChromaSubSampled && m_elChromaSubSampled) {
-            if (m_quarterResolutionEl)
-                doAllQuickAndDirty<false, true, true>(dst, blSrc, elSrc, *proc);
-            else
-                doAllQuickAndDirty<false, true, false>(dst, blSrc, elSrc, *proc);
-        } else {
-            if (m_quarterResolutionEl)
-                doAllQuickAndDirty<false, false, true>(dst, blSrc, elSrc, *proc);
-            else
-                doAllQuickAndDirty<false, false, false>(dst, blSrc, elSrc, *proc);
-        }
-    } else {
-        // Full quality mode with proper upsampling
-        ConstFrame blSrc444;
-        ConstFrame elSrc444;
-        ConstFrame elSrcR = elSrc;
-        bool frameChromaSubSampled = m_blChromaSubSampled;
-
-        if (proc->elProcessingEnabled()) {
-            if (m_quarterResolutionEl) {
-                // Upscale EL to BL resolution
-                Frame elUpscaled = upscaleEl(elSrc, m_blVi, core);
-                elSrcR = elUpscaled;
+    // frames of an earlier run, unless the RPU of the frame changed
+    const uint64_t rpuHash = m_diskCache ? DoViDiskCache::hash(rpubuf, rpusize) : 0;
+    if (m_diskCache) {
+        DoViRgbStats cached;
+        if (m_diskCache->load(n, rpuHash, dst, m_measure ? &cached : nullptr)) {
+            if (m_measure) {
+                setMeasuredProps(dst, cached);
             }
-            // Handle chroma format mismatches (only for RGB output)
-            if (!m_outYUV) {
-                if (!m_blChromaSubSampled && m_elChromaSubSampled) {
-                    Frame elUp = upsampleChroma(elSrcR, m_blVi, core);
-                    elSrc444 = elUp;
-                    frameChromaSubSampled = false;
-                }
-                if (m_blChromaSubSampled && !m_elChromaSubSampled) {
-                    Frame blUp = upsampleChroma(blSrc, m_blVi, core);
-                    blSrc444 = blUp;
-                    frameChromaSubSampled = false;
-                }
+            return dst;
+        }
+    }
+    const auto renderStart = std::chrono::steady_clock::now();
+
+    const bool elEnabled = proc->elProcessingEnabled();
+    const ConstFrame& elSrcR = elEnabled ? elSrc : blSrc;
+    const bool quarterResolutionEl = elEnabled && m_quarterResolutionEl;
+    const bool elChromaSubSampled = elEnabled ? m_elChromaSubSampled : m_blChromaSubSampled;
+
+    // tonemapping and cube of the 16 bit rows, conversion tables of float output
+    DoViRgbOutput output;
+    std::shared_ptr<const DoViEetf<16>> eetf;
+    if (m_tonemap) {
+        const uint16_t masterMaxPq = m_tmMasterMaxPq < 0 ? proc->getDynamicMaxPq() : static_cast<uint16_t>(m_tmMasterMaxPq);
+        const uint16_t masterMinPq = m_tmMasterMinPq < 0 ? proc->getDynamicMinPq() : static_cast<uint16_t>(m_tmMasterMinPq);
+        eetf = m_eetfCache->get(masterMaxPq, masterMinPq, m_tmLumScale, proc->isLimitedRangeOutput());
+        output.eetfLut = eetf->data();
+    }
+    if (m_cubes) {
+        output.cube = m_cubes->select(proc->getDynamicMaxContentLightLevel());
+        output.cubeTmpSize = m_cubes->tmpSize();
+    }
+    const int lutIdx = proc->isLimitedRangeOutput() && !m_tonemap ? 1 : 0;
+    output.floatLut = m_floatLut[lutIdx].empty() ? nullptr : m_floatLut[lutIdx].data();
+    output.halfLut = m_halfLut[lutIdx].empty() ? nullptr : m_halfLut[lutIdx].data();
+    output.ditherThresholds = m_ditherThresholds.empty() ? nullptr : m_ditherThresholds.data();
+    output.outDepth = m_outDepth;
+
+    // active area of the frame within the cropped output, with the rendered columns around it
+    const int blWidth = m_blVi.width;
+    const int blHeight = m_blVi.height;
+    int viewLeft = 0;
+    int viewRight = blWidth;
+    if (m_activeArea) {
+        const int left = std::max<int>(proc->getActiveAreaLeftOffset(), m_crop[0]);
+        const int right = blWidth - std::max<int>(proc->getActiveAreaRightOffset(), m_crop[1]);
+        const int top = std::max<int>(proc->getActiveAreaTopOffset(), m_crop[2]);
+        const int bottom = blHeight - std::max<int>(proc->getActiveAreaBottomOffset(), m_crop[3]);
+        // bars covering the whole frame are ignored
+        if (left < right && top < bottom) {
+            output.activeLeft = left;
+            output.activeRight = right;
+            output.activeTop = top;
+            output.activeBottom = bottom;
+            output.barFill = proc->isLimitedRangeOutput() ? 16 << 8 : 0;
+            viewLeft = std::max(0, (left - activeAreaMargin) & ~3);
+            viewRight = (right + activeAreaMargin + 3) & ~3;
+            if (viewRight >= blWidth) {
+                viewRight = blWidth;
             }
-        } else {
-            elSrcR = blSrc;
         }
+    }
+    output.resampler = m_resampler.get();
+    output.cropLeft = m_crop[0];
+    output.cropTop = m_crop[2];
+    DoViFrameStats stats;
+    if (m_measure) {
+        output.stats = &stats;
+        // the statistics are full range 12 bit PQ, like those of a stats file
+        output.measureLut = proc->isLimitedRangeOutput() ? m_measureLut.data() : nullptr;
+    }
+    const int activeTop = output.activeRight ? output.activeTop : 0;
+    const int activeBottom = output.activeRight ? output.activeBottom : blHeight;
 
-        if (m_outYUV) {
-            // YUV output - write directly to dst, keep original chroma subsampling
-            if (m_blChromaSubSampled) {
-                applyDovi<true>(dst,
-                    blSrc, blSrc,
-                    elSrcR, elSrcR, *proc);
-            } else {
-                applyDovi<false>(dst,
-                    blSrc, blSrc,
-                    elSrcR, elSrcR, *proc);
-            }
-        } else {
-            // RGB output - create intermediate YUV frame
-            VSVideoFormat mezFormat;
-            if (m_blChromaSubSampled && !m_elChromaSubSampled) {
-                mezFormat = core.query_video_format(cfYUV, stInteger, 16, 0, 0);
-            } else {
-                mezFormat = core.query_video_format(cfYUV, stInteger, 16,
-                    m_blChromaSubSampled ? 1 : 0, m_blChromaSubSampled ? 1 : 0);
+    if (m_qnd) {
+        // stripes are counted in BL chroma rows
+        const bool trim = proc->trimProcessingEnabled();
+        const int shift = m_blChromaSubSampled ? 1 : 0;
+        forEachStripe(blSrc.height(1), 1, 4, [&](int rowBegin, int rowEnd) {
+            DoViScratchArena::Scope scratch;
+            DoViRgbRows rows(dst, blWidth, blHeight, output);
+            // the chroma rows touching the active area, the full width of them is rendered
+            const int activeBegin = std::max(rowBegin, activeTop >> shift);
+            const int activeEnd = std::min(rowEnd, ((activeBottom - 1) >> shift) + 1);
+            if (activeBegin < activeEnd) {
+                doAllQuickAndDirty(rows, blSrc, elSrcR, elChromaSubSampled, quarterResolutionEl, *proc, activeBegin, activeEnd, trim);
             }
-            Frame mez = core.new_video_frame(mezFormat, m_blVi.width, m_blVi.height, blSrc);
-
-            // Apply DoVi processing
-            if (frameChromaSubSampled) {
-                applyDovi<true>(mez,
-                    blSrc, blSrc444 ? blSrc444 : blSrc,
-                    elSrcR, elSrc444 ? elSrc444 : elSrcR, *proc);
+            rows.finishBarRows(rowBegin << shift, std::min(rowEnd << shift, blHeight));
+        });
+    } else if (m_preview) {
+        // half resolution, composed from the BL filtered down to 4:4:4 at chroma resolution
+        const bool trim = proc->trimProcessingEnabled();
+        forEachStripe(m_vi.height, 1, 8, [&](int rowBegin, int rowEnd) {
+            DoViScratchArena::Scope scratch;
+            DoViStripEngine engine(blSrc, elSrcR, m_blChromaSubSampled, elChromaSubSampled, quarterResolutionEl, *proc, 0, blWidth, true, m_upsampler);
+            DoViRgbRows rows(dst, m_vi.width, m_vi.height, output);
+            engine.renderRgb(rows, rowBegin, rowEnd, trim);
+        });
+    } else if (m_composeCache) {
+        // BakerMulti: the composition is shared with the other outputs, only conversion and trims are done here
+        ConstFrame composed = composeClaim.get([&] {
+            return composeFrame(core, blSrc, elSrcR, elChromaSubSampled, quarterResolutionEl, *proc);
+        });
+        const bool trim = proc->trimProcessingEnabled();
+        forEachStripe(m_vi.height, 2, 16, [&](int rowBegin, int rowEnd) {
+            DoViScratchArena::Scope scratch;
+            DoViStripEngine engine(composed, *proc, m_upsampler);
+            if (m_outYUV) {
+                engine.renderYuv(dst, rowBegin, rowEnd);
             } else {
-                applyDovi<false>(mez,
-                    blSrc, blSrc444 ? blSrc444 : blSrc,
-                    elSrcR, elSrc444 ? elSrc444 : elSrcR, *proc);
-            }
-
-            // Upsample chroma if still subsampled
-            ConstFrame mez444 = mez;
-            if (frameChromaSubSampled) {
-                Frame mezUp = upsampleChroma(mez, m_blVi, core);
-                mez444 = mezUp;
+                DoViRgbRows rows(dst, blWidth, blHeight, output);
+                engine.renderRgb(rows, rowBegin, rowEnd, trim);
             }
-
-            // Convert to RGB
-            convert2rgb(dst, mez444, mez444, *proc);
+        });
+    } else {
+        // Full quality mode with proper upsampling
+        if (m_outYUV) {
+            // YUV output - keep original chroma subsampling, a quarter resolution EL is upscaled on the fly
+            forEachStripe(m_vi.height, 2, 16, [&](int rowBegin, int rowEnd) {
+                DoViScratchArena::Scope scratch;
+                DoViStripEngine engine(blSrc, elSrcR, m_blChromaSubSampled, elChromaSubSampled, quarterResolutionEl, *proc, m_upsampler);
+                engine.renderYuv(dst, rowBegin, rowEnd);
+            });
+        } else if (m_resampler) {
+            // RGB output resized on the fly, stripes are counted in output rows and render the
+            // source rows their filter taps reach, in order, so the ring of the resampler fills up
+            const bool trim = proc->trimProcessingEnabled();
+            forEachStripe(m_vi.height, 1, 8, [&](int rowBegin, int rowEnd) {
+                DoViScratchArena::Scope scratch;
+                DoViStripEngine engine(blSrc, elSrcR, m_blChromaSubSampled, elChromaSubSampled, quarterResolutionEl, *proc, viewLeft, viewRight,
+                                       false, m_upsampler);
+                DoViRgbRows rows(dst, blWidth, blHeight, output);
+                rows.resampleRows(rowBegin, rowEnd);
+                const int srcBegin = m_resampler->firstRow(rowBegin) + m_crop[2];
+                const int srcEnd = m_resampler->lastRow(rowEnd - 1) + 1 + m_crop[2];
+                rows.finishBarRows(srcBegin, std::min(srcEnd, activeTop));
+                engine.renderRgb(rows, std::max(srcBegin, activeTop), std::min(srcEnd, activeBottom), trim);
+                rows.finishBarRows(std::max(srcBegin, activeBottom), srcEnd);
+            });
+        } else {
+            // RGB output - compose, upsample chroma, convert and trim row by row.
+            // Every stripe gets its own engine, the few rows around stripe boundaries are composed twice.
+            // With an active area only its rows and the columns around it are rendered.
+            const bool trim = proc->trimProcessingEnabled();
+            forEachStripe(blHeight, 2, 16, [&](int rowBegin, int rowEnd) {
+                DoViScratchArena::Scope scratch;
+                DoViStripEngine engine(blSrc, elSrcR, m_blChromaSubSampled, elChromaSubSampled, quarterResolutionEl, *proc, viewLeft, viewRight,
+                                       false, m_upsampler);
+                DoViRgbRows rows(dst, blWidth, blHeight, output);
+                engine.renderRgb(rows, std::max(rowBegin, activeTop), std::min(rowEnd, activeBottom), trim);
+                rows.finishBarRows(rowBegin, rowEnd);
+            });
         }
     }
 
-    // Trim processing is only applicable to RGB output
-    if (!m_outYUV && proc->trimProcessingEnabled()) {
-        applyTrim(dst, dst, *proc);
+    if (m_measure) {
+        setMeasuredProps(dst, stats.rgb);
+    }
+    if (m_diskCache) {
+        const auto renderMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - renderStart).count();
+        m_diskCache->store(n, rpuHash, dst, m_measure ? &stats.rgb : nullptr, renderMicros);
     }
-
     return dst;
 }
 
-template<bool blChromaSubsampling, bool elChromaSubsampling, bool quarterResolutionEl>
-void DoViBakerVS::doAllQuickAndDirty(Frame& dst, const ConstFrame& blSrc, const ConstFrame& elSrc, DoViProcessor& proc) const
+std::string DoViBakerVS::cacheKey(const ConstMap& in, const char* rpuPath) const
 {
-    const ptrdiff_t blSrcPitchY = blSrc.stride(0) / sizeof(uint16_t);
-    const ptrdiff_t elSrcPitchY = elSrc.stride(0) / sizeof(uint16_t);
-    const ptrdiff_t dstPitch = dst.stride(0) / sizeof(uint16_t);
-
-    const ptrdiff_t blSrcPitchUV = blSrc.stride(1) / sizeof(uint16_t);
-    const int elSrcHeightUV = elSrc.height(1);
-    const int elSrcWidthUV = m_hasEl ? m_elVi.width >> (elChromaSubsampling ? 1 : 0) : m_blVi.width >> (blChromaSubsampling ? 1 : 0);
-    const ptrdiff_t elSrcPitchUV = elSrc.stride(1) / sizeof(uint16_t);
-
-    constexpr int blYvsElUVshifts = (elChromaSubsampling ? 1 : 0) + (quarterResolutionEl ? 1 : 0);
-    std::array<const uint16_t*, (1 << blYvsElUVshifts)> blSrcYp;
-    std::array<const uint16_t*, (1 << (elChromaSubsampling ? 1 : 0))> elSrcYp;
-    std::array<uint16_t*, (1 << blYvsElUVshifts)> dstRp;
-    blSrcYp[0] = reinterpret_cast<const uint16_t*>(blSrc.read_ptr(0));
-    elSrcYp[0] = reinterpret_cast<const uint16_t*>(elSrc.read_ptr(0));
-    dstRp[0] = reinterpret_cast<uint16_t*>(dst.write_ptr(0));
-
-    constexpr int blUVvsElUVshifts = std::max((quarterResolutionEl ? 1 : 0) + (elChromaSubsampling ? 1 : 0) - (blChromaSubsampling ? 1 : 0), 0);
-    std::array<const uint16_t*, (1 << blUVvsElUVshifts)> blSrcUp;
-    std::array<const uint16_t*, 1> elSrcUp;
-    std::array<uint16_t*, (1 << blYvsElUVshifts)> dstGp;
-    blSrcUp[0] = reinterpret_cast<const uint16_t*>(blSrc.read_ptr(1));
-    elSrcUp[0] = reinterpret_cast<const uint16_t*>(elSrc.read_ptr(1));
-    dstGp[0] = reinterpret_cast<uint16_t*>(dst.write_ptr(1));
-
-    std::array<const uint16_t*, (1 << blUVvsElUVshifts)> blSrcVp;
-    std::array<const uint16_t*, 1> elSrcVp;
-    std::array<uint16_t*, (1 << blYvsElUVshifts)> dstBp;
-    blSrcVp[0] = reinterpret_cast<const uint16_t*>(blSrc.read_ptr(2));
-    elSrcVp[0] = reinterpret_cast<const uint16_t*>(elSrc.read_ptr(2));
-    dstBp[0] = reinterpret_cast<uint16_t*>(dst.write_ptr(2));
-
-    // Initialize pointer arrays
-    for (size_t i = 1; i < elSrcVp.size(); i++) {
-        elSrcUp[i] = elSrcUp[i - 1] + elSrcPitchUV;
-        elSrcVp[i] = elSrcVp[i - 1] + elSrcPitchUV;
-    }
-    for (size_t i = 1; i < elSrcYp.size(); i++) {
-        elSrcYp[i] = elSrcYp[i - 1] + elSrcPitchY;
-    }
-    for (size_t i = 1; i < blSrcVp.size(); i++) {
-        blSrcUp[i] = blSrcUp[i - 1] + blSrcPitchUV;
-        blSrcVp[i] = blSrcVp[i - 1] + blSrcPitchUV;
-    }
-    for (size_t i = 1; i < dstBp.size(); i++) {
-        blSrcYp[i] = blSrcYp[i - 1] + blSrcPitchY;
-        dstRp[i] = dstRp[i - 1] + dstPitch;
-        dstGp[i] = dstGp[i - 1] + dstPitch;
-        dstBp[i] = dstBp[i - 1] + dstPitch;
-    }
-
-    for (int heluv = 0; heluv < elSrcHeightUV; heluv++) {
-        for (int weluv = 0; weluv < elSrcWidthUV; weluv++) {
-
-            const uint16_t elu = elSrcUp[0][weluv];
-            const uint16_t elv = elSrcVp[0][weluv];
-
-            for (int hDbluv = 0; hDbluv < (1 << blUVvsElUVshifts); hDbluv++) {
-                for (int wDbluv = 0; wDbluv < (1 << blUVvsElUVshifts); wDbluv++) {
-
-                    int wbluv = (weluv << blUVvsElUVshifts) + wDbluv;
-                    const uint16_t blu = blSrcUp[hDbluv][wbluv];
-                    const uint16_t blv = blSrcVp[hDbluv][wbluv];
-
-                    int hDbluvy = hDbluv << (blChromaSubsampling ? 1 : 0);
-                    int wbluvy = wbluv << (blChromaSubsampling ? 1 : 0);
-                    const uint16_t mmrbly = blSrcYp[hDbluvy][wbluvy];
-
-                    const uint16_t u = proc.processSampleU(blu, elu, mmrbly, blu, blv);
-                    const uint16_t v = proc.processSampleV(blv, elv, mmrbly, blu, blv);
-
-                    for (int hDbly = 0; hDbly < (blChromaSubsampling ? 2 : 1); hDbly++) {
-                        for (int wDbly = 0; wDbly < (blChromaSubsampling ? 2 : 1); wDbly++) {
-
-                            int hDDbly = hDbluvy + hDbly;
-                            int wbly = wbluvy + wDbly;
-                            const uint16_t bly = blSrcYp[hDDbly][wbly];
-
-                            int hDely = hDDbly >> (quarterResolutionEl ? 1 : 0);
-                            int wely = wbly >> (quarterResolutionEl ? 1 : 0);
-                            const uint16_t ely = elSrcYp[hDely][wely];
-
-                            const uint16_t y = proc.processSampleY(bly, ely);
-                            proc.sample2rgb(dstRp[hDDbly][wbly], dstGp[hDDbly][wbly], dstBp[hDDbly][wbly], y, u, v);
-                        }
-                    }
-                }
-            }
-        }
-
-        // Advance pointers
-        for (size_t i = 0; i < elSrcVp.size(); i++) {
-            elSrcVp[i] += elSrcPitchUV;
-            elSrcUp[i] += elSrcPitchUV;
-        }
-        for (size_t i = 0; i < elSrcYp.size(); i++) {
-            elSrcYp[i] += elSrcPitchY * elSrcYp.size();
-        }
-        for (size_t i = 0; i < blSrcVp.size(); i++) {
-            blSrcVp[i] += blSrcPitchUV * blSrcVp.size();
-            blSrcUp[i] += blSrcPitchUV * blSrcVp.size();
+    // the arguments, except those not changing the output, with the sources by their format
+    static const char* const ignored[] = { "bl", "el", "cacheDir", "threads", "rpuOut" };
+    const VSAPI* vsapi = get_vsapi();
+    const VSMap* map = in.get();
+    std::ostringstream key;
+    key.precision(17);
+    key << "output=" << m_outputIndex << "\n";
+    for (int i = 0; i < vsapi->mapNumKeys(map); i++) {
+        const char* name = vsapi->mapGetKey(map, i);
+        if (std::any_of(std::begin(ignored), std::end(ignored), [&](const char* k) { return std::strcmp(k, name) == 0; })) {
+            continue;
         }
-        for (size_t i = 0; i < blSrcYp.size(); i++) {
-            blSrcYp[i] += blSrcPitchY * blSrcYp.size();
-            dstRp[i] += dstPitch * blSrcYp.size();
-            dstGp[i] += dstPitch * blSrcYp.size();
-            dstBp[i] += dstPitch * blSrcYp.size();
-        }
-    }
-}
-
-// Vertical upsampling - produces 2 output rows per input row
-template<int vertLen, int nD>
-void DoViBakerVS::upsampleVert(Frame& dst, const ConstFrame& src, int plane,
-    const std::array<int, vertLen>& Dn0p,
-    const upscaler_t evenUpscaler, const upscaler_t oddUpscaler)
-{
-    const int srcHeight = src.height(plane);
-    const int srcWidth = src.width(plane);
-    const ptrdiff_t srcPitch = src.stride(plane) / sizeof(uint16_t);
-    const uint16_t* srcPb = reinterpret_cast<const uint16_t*>(src.read_ptr(plane));
-
-    const ptrdiff_t dstPitch = dst.stride(plane) / sizeof(uint16_t);
-    uint16_t* dstPeven = reinterpret_cast<uint16_t*>(dst.write_ptr(plane));
-    uint16_t* dstPodd = dstPeven + dstPitch;
-
-    std::array<const uint16_t*, vertLen> srcP;
-    std::array<uint16_t, vertLen> value;
-    auto& srcP0 = srcP[nD];
-
-    for (int h0 = 0; h0 < srcHeight; h0++) {
-        // Border handling: clamp to [0, srcHeight-1]
-        for (int i = 0; i < nD; i++) {
-            int factor = std::max(h0 + Dn0p[i], 0);
-            srcP[i] = srcPb + factor * srcPitch;
-        }
-        srcP0 = srcPb + h0 * srcPitch;
-        for (int i = nD + 1; i < vertLen; i++) {
-            int factor = std::min(h0 + Dn0p[i], srcHeight - 1);
-            srcP[i] = srcPb + factor * srcPitch;
-        }
-
-        for (int w = 0; w < srcWidth; w++) {
-            for (int i = 0; i < vertLen; i++) {
-                value[i] = srcP[i][w];
+        key << name << "=";
+        const int type = vsapi->mapGetType(map, name);
+        for (int j = 0; j < vsapi->mapNumElements(map, name); j++) {
+            int error = 0;
+            key << (j ? "," : "");
+            if (type == ptInt) {
+                key << vsapi->mapGetInt(map, name, j, &error);
+            } else if (type == ptFloat) {
+                key << vsapi->mapGetFloat(map, name, j, &error);
+            } else if (type == ptData) {
+                key << vsapi->mapGetData(map, name, j, &error);
             }
-            dstPeven[w] = evenUpscaler(&value[0], nD);
-            dstPodd[w] = oddUpscaler(&value[0], nD);
         }
-
-        dstPeven += 2 * dstPitch;
-        dstPodd += 2 * dstPitch;
+        key << "\n";
     }
-}
-
-// Horizontal upsampling - produces 2 output columns per input column
-template<int vertLen, int nD>
-void DoViBakerVS::upsampleHorz(Frame& dst, const ConstFrame& src, int plane,
-    const std::array<int, vertLen>& Dn0p,
-    const upscaler_t evenUpscaler, const upscaler_t oddUpscaler)
-{
-    const int srcHeight = src.height(plane);
-    const int srcWidth = src.width(plane);
-    const ptrdiff_t srcPitch = src.stride(plane) / sizeof(uint16_t);
-    const uint16_t* srcP = reinterpret_cast<const uint16_t*>(src.read_ptr(plane));
-
-    const ptrdiff_t dstPitch = dst.stride(plane) / sizeof(uint16_t);
-    uint16_t* dstP = reinterpret_cast<uint16_t*>(dst.write_ptr(plane));
-
-    static const int pD = vertLen - nD - 1;
-    std::array<uint16_t, vertLen> value;
-
-    for (int h = 0; h < srcHeight; h++) {
-        // Center region - no border handling needed
-        for (int w = nD; w < srcWidth - pD; w++) {
-            dstP[2 * w] = evenUpscaler(&srcP[w - nD], nD);
-            dstP[2 * w + 1] = oddUpscaler(&srcP[w - nD], nD);
-        }
-
-        // Left edge - clamp left samples
-        for (int w = 0; w < nD; w++) {
-            for (int i = 0; i < nD; i++) {
-                int wd = std::max(w + Dn0p[i], 0);
-                value[i] = srcP[wd];
-            }
-            std::copy_n(&srcP[w], pD + 1, &value[nD]);
-            dstP[2 * w] = evenUpscaler(&value[0], nD);
-            dstP[2 * w + 1] = oddUpscaler(&value[0], nD);
+    const VSVideoInfo* clips[] = { &m_blVi, m_hasEl ? &m_elVi : nullptr };
+    for (const VSVideoInfo* vi : clips) {
+        if (vi) {
+            key << "clip=" << vi->format.colorFamily << "," << vi->format.sampleType << "," << vi->format.bitsPerSample << ","
+                << vi->format.subSamplingW << "," << vi->format.subSamplingH << "," << vi->width << "x" << vi->height << ","
+                << vi->numFrames << "\n";
         }
+    }
 
-        // Right edge - clamp right samples
-        for (int w = srcWidth - pD; w < srcWidth; w++) {
-            for (int i = nD + 1; i < vertLen; i++) {
-                int wd = std::min(w + Dn0p[i], srcWidth - 1);
-                value[i] = srcP[wd];
-            }
-            std::copy_n(&srcP[w - nD], nD + 1, &value[0]);
-            dstP[2 * w] = evenUpscaler(&value[0], nD);
-            dstP[2 * w + 1] = oddUpscaler(&value[0], nD);
+    // the RPU file by its contents, integrated RPUs are checked per frame
+    if (rpuPath) {
+        std::ifstream file(rpuPath, std::ios::binary);
+        uint64_t rpuHash = 0xcbf29ce484222325ULL;
+        std::vector<char> buffer(1 << 16);
+        while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+            rpuHash = DoViDiskCache::hash(buffer.data(), static_cast<size_t>(file.gcount()), rpuHash);
         }
-
-        srcP += srcPitch;
-        dstP += dstPitch;
+        key << "rpuHash=" << std::hex << rpuHash << std::dec << "\n";
     }
+    return key.str();
 }
 
-// Upscale quarter-resolution EL to full resolution (2x in each dimension)
-Frame DoViBakerVS::upscaleEl(const ConstFrame& src, const VSVideoInfo& dstVi, const Core& core)
+void DoViBakerVS::setMeasuredProps(Frame& dst, const DoViRgbStats& stats)
 {
-    // Create intermediate frame at half target width (vertical upsampling first)
-    VSVideoFormat mezFormat = core.query_video_format(cfYUV, stInteger, 16,
-        m_elChromaSubSampled ? 1 : 0, m_elChromaSubSampled ? 1 : 0);
-    Frame mez = core.new_video_frame(mezFormat, dstVi.width / 2, dstVi.height, src);
-
-    // Step 1: Vertical upsampling (5-tap for luma, 4-tap for chroma)
-    upsampleVert<5, 2>(mez, src, 0, {-2, -1, 0, 1, 2},
-        &DoViProcessor::upsampleLumaEven, &DoViProcessor::upsampleLumaOdd);
-    upsampleVert<4, 1>(mez, src, 1, {-1, 0, 1, 2},
-        &DoViProcessor::upsampleChromaEven, &DoViProcessor::upsampleChromaOdd);
-    upsampleVert<4, 1>(mez, src, 2, {-1, 0, 1, 2},
-        &DoViProcessor::upsampleChromaEven, &DoViProcessor::upsampleChromaOdd);
-
-    // Create output frame at full target size
-    Frame dst = core.new_video_frame(mezFormat, dstVi.width, dstVi.height, src);
-
-    // Step 2: Horizontal upsampling
-    upsampleHorz<5, 2>(dst, mez, 0, {-2, -1, 0, 1, 2},
-        &DoViProcessor::upsampleLumaEven, &DoViProcessor::upsampleLumaOdd);
-    upsampleHorz<4, 1>(dst, mez, 1, {-1, 0, 1, 2},
-        &DoViProcessor::upsampleChromaEven, &DoViProcessor::upsampleChromaOdd);
-    upsampleHorz<4, 1>(dst, mez, 2, {-1, 0, 1, 2},
-        &DoViProcessor::upsampleChromaEven, &DoViProcessor::upsampleChromaOdd);
-
-    return dst;
+    // 12 bit PQ like the RPU and stats file values, nothing measured if the active area is empty
+    auto toPq12 = [](uint64_t code) { return static_cast<int64_t>(std::min<uint64_t>((code + 8) >> 4, 4095)); };
+    const bool measured = stats.count > 0;
+    const uint64_t avg = measured ? (stats.sum + stats.count / 2) / stats.count : 0;
+    dst.frame_props_rw().set_prop("_dovi_measured_max_pq", measured ? toPq12(stats.max) : int64_t{ 0 });
+    dst.frame_props_rw().set_prop("_dovi_measured_min_pq", measured ? toPq12(stats.min) : int64_t{ 0 });
+    dst.frame_props_rw().set_prop("_dovi_measured_avg_pq", toPq12(avg));
+    std::array<int64_t, 64> histogram;
+    std::copy(std::begin(stats.histogram), std::end(stats.histogram), histogram.begin());
+    get_vsapi()->mapSetIntArray(dst.frame_props_rw().get(), "_dovi_pq_hist", histogram.data(), static_cast<int>(histogram.size()));
 }
 
-// Upsample chroma from 4:2:0 to 4:4:4
-Frame DoViBakerVS::upsampleChroma(const ConstFrame& src, const VSVideoInfo& dstVi, const Core& core)
+ConstFrame DoViBakerVS::composeFrame(const Core& core, const ConstFrame& blSrc, const ConstFrame& elSrc,
+                                     bool elChromaSubsampling, bool quarterResolutionEl, const DoViProcessor& proc) const
 {
-    // Create intermediate frame for vertical upsampling (half width, full height)
-    VSVideoFormat mezFormat = core.query_video_format(cfYUV, stInteger, 16, 1, 0);
-    Frame mez = core.new_video_frame(mezFormat, dstVi.width, dstVi.height, src);
-
-    // Copy luma directly
-    const uint16_t* srcY = reinterpret_cast<const uint16_t*>(src.read_ptr(0));
-    uint16_t* dstY = reinterpret_cast<uint16_t*>(mez.write_ptr(0));
-    const ptrdiff_t srcPitchY = src.stride(0) / sizeof(uint16_t);
-    const ptrdiff_t dstPitchY = mez.stride(0) / sizeof(uint16_t);
-    for (int h = 0; h < dstVi.height; h++) {
-        std::memcpy(dstY, srcY, dstVi.width * sizeof(uint16_t));
-        srcY += srcPitchY;
-        dstY += dstPitchY;
-    }
-
-    // Vertical upsampling for U and V
-    upsampleVert<4, 1>(mez, src, 1, {-1, 0, 1, 2},
-        &DoViProcessor::upsampleChromaEven, &DoViProcessor::upsampleChromaOdd);
-    upsampleVert<4, 1>(mez, src, 2, {-1, 0, 1, 2},
-        &DoViProcessor::upsampleChromaEven, &DoViProcessor::upsampleChromaOdd);
-
-    // Create output frame at 4:4:4
-    VSVideoFormat dstFormat = core.query_video_format(cfYUV, stInteger, 16, 0, 0);
-    Frame dst = core.new_video_frame(dstFormat, dstVi.width, dstVi.height, src);
-
-    // Copy luma directly to output
-    srcY = reinterpret_cast<const uint16_t*>(mez.read_ptr(0));
-    dstY = reinterpret_cast<uint16_t*>(dst.write_ptr(0));
-    const ptrdiff_t mezPitchY = mez.stride(0) / sizeof(uint16_t);
-    const ptrdiff_t outPitchY = dst.stride(0) / sizeof(uint16_t);
-    for (int h = 0; h < dstVi.height; h++) {
-        std::memcpy(dstY, srcY, dstVi.width * sizeof(uint16_t));
-        srcY += mezPitchY;
-        dstY += outPitchY;
-    }
-
-    // Horizontal upsampling for U and V
-    upsampleHorz<4, 1>(dst, mez, 1, {-1, 0, 1, 2},
-        &DoViProcessor::upsampleChromaEven, &DoViProcessor::upsampleChromaOdd);
-    upsampleHorz<4, 1>(dst, mez, 2, {-1, 0, 1, 2},
-        &DoViProcessor::upsampleChromaEven, &DoViProcessor::upsampleChromaOdd);
-
-    return dst;
+    const int subsampling = m_blChromaSubSampled && elChromaSubsampling ? 1 : 0;
+    Frame composed = core.new_video_frame(core.query_video_format(cfYUV, stInteger, 16, subsampling, subsampling),
+        m_blVi.width, m_blVi.height);
+    forEachStripe(m_blVi.height, 2, 16, [&](int rowBegin, int rowEnd) {
+        DoViScratchArena::Scope scratch;
+        DoViStripEngine engine(blSrc, elSrc, m_blChromaSubSampled, elChromaSubsampling, quarterResolutionEl, proc, m_upsampler);
+        engine.renderYuv(composed, rowBegin, rowEnd);
+    });
+    return composed;
 }
 
-// Apply DoVi processing with proper chroma handling
-template<bool chromaSubsampling>
-void DoViBakerVS::applyDovi(Frame& dst, const ConstFrame& blSrcY, const ConstFrame& blSrcUV,
-                             const ConstFrame& elSrcY, const ConstFrame& elSrcUV, DoViProcessor& proc) const
+// Quick and dirty mode - nearest neighbour resampling of the EL and the processed chroma.
+// The chroma is processed at BL chroma resolution, with the nearest EL chroma sample
+// and the top left BL luma sample of each chroma position as MMR input.
+void DoViBakerVS::doAllQuickAndDirty(DoViRgbRows& dst, const ConstFrame& blSrc, const ConstFrame& elSrc,
+                                     bool elChromaSubsampling, bool quarterResolutionEl, DoViProcessor& proc,
+                                     int rowBegin, int rowEnd, bool applyTrim) const
 {
-    const ptrdiff_t blSrcPitchY = blSrcY.stride(0) / sizeof(uint16_t);
-    const ptrdiff_t elSrcPitchY = elSrcY.stride(0) / sizeof(uint16_t);
-    const ptrdiff_t dstPitchY = dst.stride(0) / sizeof(uint16_t);
-
-    std::array<const uint16_t*, chromaSubsampling ? 2 : 1> blSrcYp;
-    std::array<const uint16_t*, chromaSubsampling ? 2 : 1> elSrcYp;
-    std::array<uint16_t*, chromaSubsampling ? 2 : 1> dstYp;
-
-    blSrcYp[0] = reinterpret_cast<const uint16_t*>(blSrcY.read_ptr(0));
-    elSrcYp[0] = reinterpret_cast<const uint16_t*>(elSrcY.read_ptr(0));
-    dstYp[0] = reinterpret_cast<uint16_t*>(dst.write_ptr(0));
-    if constexpr (chromaSubsampling) {
-        blSrcYp[1] = blSrcYp[0] + blSrcPitchY;
-        elSrcYp[1] = elSrcYp[0] + elSrcPitchY;
-        dstYp[1] = dstYp[0] + dstPitchY;
-    }
-
-    const int blSrcHeightUV = blSrcUV.height(1);
-    const int blSrcWidthUV = blSrcUV.width(1);
-    const ptrdiff_t blSrcPitchUV = blSrcUV.stride(1) / sizeof(uint16_t);
-    const ptrdiff_t elSrcPitchUV = elSrcUV.stride(1) / sizeof(uint16_t);
-    const ptrdiff_t dstPitchUV = dst.stride(1) / sizeof(uint16_t);
-
-    const uint16_t* blSrcUp = reinterpret_cast<const uint16_t*>(blSrcUV.read_ptr(1));
-    const uint16_t* elSrcUp = reinterpret_cast<const uint16_t*>(elSrcUV.read_ptr(1));
-    uint16_t* dstUp = reinterpret_cast<uint16_t*>(dst.write_ptr(1));
-
-    const uint16_t* blSrcVp = reinterpret_cast<const uint16_t*>(blSrcUV.read_ptr(2));
-    const uint16_t* elSrcVp = reinterpret_cast<const uint16_t*>(elSrcUV.read_ptr(2));
-    uint16_t* dstVp = reinterpret_cast<uint16_t*>(dst.write_ptr(2));
-
-    constexpr int csVal = chromaSubsampling ? 1 : 0;
-
-    for (int huv = 0; huv < blSrcHeightUV; huv++) {
-        if constexpr (chromaSubsampling) {
-            // Left edge
-            int wuv = 0;
-            for (int j = 0; j < 2; j++) {
-                for (int i = 0; i < 2; i++) {
-                    const int w = 2 * wuv + i;
-                    dstYp[j][w] = proc.processSampleY(blSrcYp[j][w], elSrcYp[j][w]);
-                }
-            }
-            int mmrBlY1 = 3 * blSrcYp[0][2 * wuv] + blSrcYp[0][2 * wuv + 1] + 2;
-            int mmrBlY2 = 3 * blSrcYp[1][2 * wuv] + blSrcYp[1][2 * wuv + 1] + 2;
-            uint16_t mmrBlY = ((mmrBlY1 >> 2) + (mmrBlY2 >> 2) + 1) >> 1;
-
-            dstUp[wuv] = proc.processSampleU(blSrcUp[wuv], elSrcUp[wuv], mmrBlY, blSrcUp[wuv], blSrcVp[wuv]);
-            dstVp[wuv] = proc.processSampleV(blSrcVp[wuv], elSrcVp[wuv], mmrBlY, blSrcUp[wuv], blSrcVp[wuv]);
+    const DoViKernels& kernels = DoViKernels::get();
+    DoViFrameRows bl(blSrc);
+    DoViFrameRows el(elSrc);
+
+    const int width = m_blVi.width;
+    const int height = m_blVi.height;
+    const int widthUV = bl.width(1);
+    const int blChromaShifts = m_blChromaSubSampled ? 1 : 0;
+    const int elLumaShifts = quarterResolutionEl ? 1 : 0;
+    const int elChromaShifts = elLumaShifts + (elChromaSubsampling ? 1 : 0);
+    // resolution of the EL chroma relative to the BL chroma, negative if the EL chroma is finer
+    const int elVsBlUVshifts = elChromaShifts - blChromaShifts;
+
+    // row buffers, sized for the replicated rows which may exceed the frame width by a few samples
+    const int elWidthUV = el.width(1);
+    const size_t elRowUVSize = std::max(widthUV, elWidthUV << std::max(elVsBlUVshifts, 0));
+    const size_t fullUVSize = std::max(width, widthUV << blChromaShifts);
+    uint16_t* elRowU = DoViScratchArena::take<uint16_t>(elRowUVSize);
+    uint16_t* elRowV = DoViScratchArena::take<uint16_t>(elRowUVSize);
+    uint16_t* replicated = DoViScratchArena::take<uint16_t>(elRowUVSize);
+    uint16_t* elRowY = DoViScratchArena::take<uint16_t>(std::max(width, el.width(0) << elLumaShifts));
+    uint16_t* rowU = DoViScratchArena::take<uint16_t>(widthUV);
+    uint16_t* rowV = DoViScratchArena::take<uint16_t>(widthUV);
+    uint16_t* fullU = DoViScratchArena::take<uint16_t>(fullUVSize);
+    uint16_t* fullV = DoViScratchArena::take<uint16_t>(fullUVSize);
+    uint16_t* rowY = DoViScratchArena::take<uint16_t>(width);
+
+    // EL chroma row brought to BL chroma resolution
+    auto elChromaRow = [&](int plane, int heluv, uint16_t* buffer) -> const uint16_t* {
+        const uint16_t* src = el.row(plane, heluv);
+        if (elVsBlUVshifts == 0)
+            return src;
+        if (elVsBlUVshifts < 0) {
+            for (int wuv = 0; wuv < widthUV; wuv++)
+                buffer[wuv] = src[wuv << -elVsBlUVshifts];
+            return buffer;
+        }
+        // at most 4x, for a quarter resolution 4:2:0 EL next to a 4:4:4 BL
+        if (elVsBlUVshifts == 2) {
+            kernels.replicate2x(replicated, src, elWidthUV);
+            src = replicated;
+        }
+        kernels.replicate2x(buffer, src, elWidthUV << (elVsBlUVshifts - 1));
+        return buffer;
+    };
+
+    const int16_t* coef = proc.getYccToRgbCoef();
+    const uint32_t* offset = proc.getYccToRgbOffset();
+    const bool ipt = proc.isIptInput();
+
+    for (int huv = rowBegin; huv < rowEnd; huv++) {
+        const int hy0 = huv << blChromaShifts;
+        const int heluv = hy0 >> elChromaShifts;
+        const uint16_t* blU = bl.row(1, huv);
+        const uint16_t* blV = bl.row(2, huv);
+        const uint16_t* elU = elChromaRow(1, heluv, elRowU);
+        const uint16_t* elV = elChromaRow(2, heluv, elRowV);
+        proc.processRowU(rowU, blU, blV, elU, bl.row(0, hy0), 1 << blChromaShifts, widthUV);
+        proc.processRowV(rowV, blU, blV, elV, bl.row(0, hy0), 1 << blChromaShifts, widthUV);
+
+        const uint16_t* u = rowU;
+        const uint16_t* v = rowV;
+        if (m_blChromaSubSampled) {
+            kernels.replicate2x(fullU, u, widthUV);
+            kernels.replicate2x(fullV, v, widthUV);
+            u = fullU;
+            v = fullV;
         }
 
-        // Center region
-        for (int wuv = csVal; wuv < blSrcWidthUV - csVal; wuv++) {
-            for (int j = 0; j < (chromaSubsampling ? 2 : 1); j++) {
-                for (int i = 0; i < (chromaSubsampling ? 2 : 1); i++) {
-                    const int w = (chromaSubsampling ? 2 : 1) * wuv + i;
-                    dstYp[j][w] = proc.processSampleY(blSrcYp[j][w], elSrcYp[j][w]);
-                }
+        const int hyEnd = std::min(hy0 + (1 << blChromaShifts), height);
+        for (int hy = hy0; hy < hyEnd; hy++) {
+            const uint16_t* elY = el.row(0, hy >> elLumaShifts);
+            if (quarterResolutionEl) {
+                kernels.replicate2x(elRowY, elY, el.width(0));
+                elY = elRowY;
             }
-            uint16_t mmrBlY;
-            if constexpr (chromaSubsampling) {
-                int mmrBlY1 = blSrcYp[0][2 * wuv - 1] + 2 * blSrcYp[0][2 * wuv] + blSrcYp[0][2 * wuv + 1] + 2;
-                int mmrBlY2 = blSrcYp[1][2 * wuv - 1] + 2 * blSrcYp[1][2 * wuv] + blSrcYp[1][2 * wuv + 1] + 2;
-                mmrBlY = ((mmrBlY1 >> 2) + (mmrBlY2 >> 2) + 1) >> 1;
-            } else {
-                mmrBlY = blSrcYp[0][wuv];
+            proc.processRowY(rowY, bl.row(0, hy), elY, width);
+
+            uint16_t* r = dst.row(0, hy);
+            uint16_t* g = dst.row(1, hy);
+            uint16_t* b = dst.row(2, hy);
+            kernels.ycc2rgb(r, g, b, rowY, u, v, width, coef, offset);
+            if (ipt) {
+                proc.processLmsRow(r, g, b, width);
             }
-            dstUp[wuv] = proc.processSampleU(blSrcUp[wuv], elSrcUp[wuv], mmrBlY, blSrcUp[wuv], blSrcVp[wuv]);
-            dstVp[wuv] = proc.processSampleV(blSrcVp[wuv], elSrcVp[wuv], mmrBlY, blSrcUp[wuv], blSrcVp[wuv]);
-        }
-
-        if constexpr (chromaSubsampling) {
-            // Right edge
-            int wuv = blSrcWidthUV - 1;
-            for (int j = 0; j < 2; j++) {
-                for (int i = 0; i < 2; i++) {
-                    const int w = 2 * wuv + i;
-                    dstYp[j][w] = proc.processSampleY(blSrcYp[j][w], elSrcYp[j][w]);
-                }
+            if (applyTrim) {
+                proc.processTrimRow(r, g, b, width);
             }
-            int mmrBlY1 = blSrcYp[0][2 * wuv - 1] + 3 * blSrcYp[0][2 * wuv] + 2;
-            int mmrBlY2 = blSrcYp[1][2 * wuv - 1] + 3 * blSrcYp[1][2 * wuv] + 2;
-            uint16_t mmrBlY = ((mmrBlY1 >> 2) + (mmrBlY2 >> 2) + 1) >> 1;
-
-            dstUp[wuv] = proc.processSampleU(blSrcUp[wuv], elSrcUp[wuv], mmrBlY, blSrcUp[wuv], blSrcVp[wuv]);
-            dstVp[wuv] = proc.processSampleV(blSrcVp[wuv], elSrcVp[wuv], mmrBlY, blSrcUp[wuv], blSrcVp[wuv]);
-        }
-
-        // Advance row pointers
-        for (int i = 0; i < (chromaSubsampling ? 2 : 1); i++) {
-            blSrcYp[i] += blSrcPitchY * (chromaSubsampling ? 2 : 1);
-            elSrcYp[i] += elSrcPitchY * (chromaSubsampling ? 2 : 1);
-            dstYp[i] += dstPitchY * (chromaSubsampling ? 2 : 1);
+            dst.finish(hy);
         }
-        blSrcUp += blSrcPitchUV;
-        blSrcVp += blSrcPitchUV;
-        elSrcUp += elSrcPitchUV;
-        elSrcVp += elSrcPitchUV;
-        dstUp += dstPitchUV;
-        dstVp += dstPitchUV;
     }
 }
-
-// Convert processed YUV to RGB
-void DoViBakerVS::convert2rgb(Frame& dst, const ConstFrame& srcY, const ConstFrame& srcUV, DoViProcessor& proc) const
-{
-    const ptrdiff_t srcPitchY = srcY.stride(0) / sizeof(uint16_t);
-    const ptrdiff_t dstPitch = dst.stride(0) / sizeof(uint16_t);
-
-    const uint16_t* srcYp = reinterpret_cast<const uint16_t*>(srcY.read_ptr(0));
-    uint16_t* dstRp = reinterpret_cast<uint16_t*>(dst.write_ptr(0));
-
-    const int srcHeightUV = srcUV.height(1);
-    const int srcWidthUV = srcUV.width(1);
-    const ptrdiff_t srcPitchUV = srcUV.stride(1) / sizeof(uint16_t);
-
-    const uint16_t* srcUp = reinterpret_cast<const uint16_t*>(srcUV.read_ptr(1));
-    uint16_t* dstGp = reinterpret_cast<uint16_t*>(dst.write_ptr(1));
-
-    const uint16_t* srcVp = reinterpret_cast<const uint16_t*>(srcUV.read_ptr(2));
-    uint16_t* dstBp = reinterpret_cast<uint16_t*>(dst.write_ptr(2));
-
-    for (int huv = 0; huv < srcHeightUV; huv++) {
-        for (int wuv = 0; wuv < srcWidthUV; wuv++) {
-            proc.sample2rgb(dstRp[wuv], dstGp[wuv], dstBp[wuv], srcYp[wuv], srcUp[wuv], srcVp[wuv]);
-        }
-
-        srcYp += srcPitchY;
-        srcUp += srcPitchUV;
-        srcVp += srcPitchUV;
-
-        dstRp += dstPitch;
-        dstGp += dstPitch;
-        dstBp += dstPitch;
-    }
-}
-
-void DoViBakerVS::applyTrim(Frame& dst, const ConstFrame& src, DoViProcessor& proc) const
-{
-    const int width = m_vi.width;
-    const int height = m_vi.height;
-
-    const uint16_t* srcP[3];
-    ptrdiff_t srcPitch[3];
-    uint16_t* dstP[3];
-    ptrdiff_t dstPitch[3];
-
-    for (int p = 0; p < 3; ++p) {
-        srcP[p] = reinterpret_cast<const uint16_t*>(src.read_ptr(p));
-        srcPitch[p] = src.stride(p) / sizeof(uint16_t);
-        dstP[p] = reinterpret_cast<uint16_t*>(dst.write_ptr(p));
-        dstPitch[p] = dst.stride(p) / sizeof(uint16_t);
-    }
-
-    for (int h = 0; h < height; ++h) {
-        for (int w = 0; w < width; ++w) {
-            proc.processTrim(dstP[0][w], dstP[1][w], dstP[2][w], srcP[0][w], srcP[1][w], srcP[2][w]);
-        }
-
-        for (int p = 0; p < 3; ++p) {
-            srcP[p] += srcPitch[p];
-            dstP[p] += dstPitch[p];
-        }
-    }
-}
-
-// Explicit template instantiations
-template void DoViBakerVS::doAllQuickAndDirty<true, true, true>(Frame&, const ConstFrame&, const ConstFrame&, DoViProcessor&) const;
-template void DoViBakerVS::doAllQuickAndDirty<true, true, false>(Frame&, const ConstFrame&, const ConstFrame&, DoViProcessor&) const;
-template void DoViBakerVS::doAllQuickAndDirty<true, false, true>(Frame&, const ConstFrame&, const ConstFrame&, DoViProcessor&) const;
-template void DoViBakerVS::doAllQuickAndDirty<true, false, false>(Frame&, const ConstFrame&, const ConstFrame&, DoViProcessor&) const;
-template void DoViBakerVS::doAllQuickAndDirty<false, true, true>(Frame&, const ConstFrame&, const ConstFrame&, DoViProcessor&) const;
-template void DoViBakerVS::doAllQuickAndDirty<false, true, false>(Frame&, const ConstFrame&, const ConstFrame&, DoViProcessor&) const;
-template void DoViBakerVS::doAllQuickAndDirty<false, false, true>(Frame&, const ConstFrame&, const ConstFrame&, DoViProcessor&) const;
-template void DoViBakerVS::doAllQuickAndDirty<false, false, false>(Frame&, const ConstFrame&, const ConstFrame&, DoViProcessor&) const;
-
-// Upsampling template instantiations
-template void DoViBakerVS::upsampleVert<5, 2>(Frame&, const ConstFrame&, int, const std::array<int, 5>&, const upscaler_t, const upscaler_t);
-template void DoViBakerVS::upsampleVert<4, 1>(Frame&, const ConstFrame&, int, const std::array<int, 4>&, const upscaler_t, const upscaler_t);
-template void DoViBakerVS::upsampleHorz<5, 2>(Frame&, const ConstFrame&, int, const std::array<int, 5>&, const upscaler_t, const upscaler_t);
-template void DoViBakerVS::upsampleHorz<4, 1>(Frame&, const ConstFrame&, int, const std::array<int, 4>&, const upscaler_t, const upscaler_t);
-
-// DoVi processing template instantiations
-template void DoViBakerVS::applyDovi<true>(Frame&, const ConstFrame&, const ConstFrame&, const ConstFrame&, const ConstFrame&, DoViProcessor&) const;
-template void DoViBakerVS::applyDovi<false>(Frame&, const ConstFrame&, const ConstFrame&, const ConstFrame&, const ConstFrame&, DoViProcessor&) const;
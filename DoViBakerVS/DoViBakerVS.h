@@ -1,6 +1,14 @@
 #pragma once
 #include "VapourSynth4++.hpp"
 #include "DoViProcessor.h"
+#include "DoViEetfCache.h"
+#include "DoViCubeSet.h"
+#include "DoViComposeCache.h"
+#include "DoViDiskCache.h"
+#include "DoViResampler.h"
+#include "DoViStripEngine.h"
+#include "DoViRpuWriter.h"
+#include "DoViStripeScheduler.h"
 #include <memory>
 #include <array>
 #include <vector>
@@ -8,11 +16,19 @@
 #include <mutex>
 #include <condition_variable>
 #include <cstdint>
+#include <functional>
 
 using namespace vsxx4;
 
 // RAII wrapper for borrowing a processor from the pool
 class DoViProcessorLease;
+class DoViRgbRows;
+
+// One output of BakerMulti, handed to the filter instance as user data
+struct DoViBakerMultiOutput {
+    std::shared_ptr<DoViComposeCache> cache;
+    int index;
+};
 
 class DoViBakerVS : public FilterBase {
     friend class DoViProcessorLease;
@@ -26,35 +42,37 @@ public:
     ConstFrame get_frame_initial(int n, const Core& core, const FrameContext& frame_context, void*) override;
     ConstFrame get_frame(int n, const Core& core, const FrameContext& frame_context, void*) override;
 
-private:
-    // Processor pool management
-    DoViProcessor* acquireProcessor();
-    void releaseProcessor(DoViProcessor* proc);
+    // BakerMulti: one Baker instance per output, sharing the composition of every frame
+    static void VS_CC createMulti(const VSMap* in, VSMap* out, void* userData, VSCore* core, const VSAPI* vsapi);
 
-    // Upsampling helpers
-    typedef uint16_t(*upscaler_t)(const uint16_t* srcSamples, int idx0);
+private:
+    // Argument of this output, BakerMulti takes an array with one element per output, the last one repeating
+    template <typename T>
+    T getOutputProp(const ConstMap& in, const char* key, T defaultValue) const;
 
-    template<int vertLen, int nD>
-    void upsampleVert(Frame& dst, const ConstFrame& src, int plane, const std::array<int, vertLen>& Dn0p,
-                      const upscaler_t evenUpscaler, const upscaler_t oddUpscaler);
+    // The BL / EL composition of a frame as YUV, subsampled if both are and 4:4:4 otherwise
+    ConstFrame composeFrame(const Core& core, const ConstFrame& blSrc, const ConstFrame& elSrc,
+                            bool elChromaSubsampling, bool quarterResolutionEl, const DoViProcessor& proc) const;
 
-    template<int vertLen, int nD>
-    void upsampleHorz(Frame& dst, const ConstFrame& src, int plane, const std::array<int, vertLen>& Dn0p,
-                      const upscaler_t evenUpscaler, const upscaler_t oddUpscaler);
+    // Everything the output depends on as text, the key of the disk cache
+    std::string cacheKey(const ConstMap& in, const char* rpuPath) const;
 
-    // Processing helpers - take processor as parameter for thread safety
-    template<bool blChromaSubsampling, bool elChromaSubsampling, bool quarterResolutionEl>
-    void doAllQuickAndDirty(Frame& dst, const ConstFrame& blSrc, const ConstFrame& elSrc, DoViProcessor& proc) const;
+    // The measured statistics as frame properties
+    static void setMeasuredProps(Frame& dst, const DoViRgbStats& stats);
 
-    template<bool chromaSubsampling>
-    void applyDovi(Frame& dst, const ConstFrame& blSrcY, const ConstFrame& blSrcUV,
-                   const ConstFrame& elSrcY, const ConstFrame& elSrcUV, DoViProcessor& proc) const;
+    // Processor pool management
+    DoViProcessor* acquireProcessor();
+    void releaseProcessor(DoViProcessor* proc);
 
-    void convert2rgb(Frame& dst, const ConstFrame& srcY, const ConstFrame& srcUV, DoViProcessor& proc) const;
-    void applyTrim(Frame& dst, const ConstFrame& src, DoViProcessor& proc) const;
+    // Runs fn over stripes of [0, count) rows, on the stripe scheduler if enabled
+    void forEachStripe(int count, int align, int minRows, const std::function<void(int, int)>& fn) const;
 
-    Frame upscaleEl(const ConstFrame& src, const VSVideoInfo& dstVi, const Core& core);
-    Frame upsampleChroma(const ConstFrame& src, const VSVideoInfo& dstVi, const Core& core);
+    // Processing helper - takes processor as parameter for thread safety
+    // Processes the rows [rowBegin, rowEnd), counted in the stated unit, with row buffers
+    // from the DoViScratchArena Scope of the caller
+    void doAllQuickAndDirty(DoViRgbRows& dst, const ConstFrame& blSrc, const ConstFrame& elSrc,
+                            bool elChromaSubsampling, bool quarterResolutionEl, DoViProcessor& proc,
+                            int rowBegin, int rowEnd, bool applyTrim) const; // BL chroma rows
 
     FilterNode m_blClip;
     FilterNode m_elClip;
@@ -80,7 +98,64 @@ private:
     float m_targetMaxNits = 100.0f;
     float m_targetMinNits = 0.0f;
 
+    // RPU re-emission
+    uint8_t m_rpuConvertMode = 0;
+    bool m_rpuRemoveMapping = false;
+    bool m_rpuReplaceProp = false;
+    std::unique_ptr<DoViRpuWriter> m_rpuWriter;
+
+    // Float output: 0 = 16 bit integer, 32 = RGBS, 16 = RGBH, in PQ or linear light.
+    // The 16 bit RGB codes are converted through tables, indexed by limited range output.
+    int m_outFloat = 0;
+    bool m_outLinear = false;
+    std::array<std::vector<float>, 2> m_floatLut;
+    std::array<std::vector<uint16_t>, 2> m_halfLut;
+
+    // Integer output of 8, 10 or 12 bits is dithered down from the 16 bit rows with these thresholds
+    int m_outDepth = 16;
+    std::vector<uint16_t> m_ditherThresholds;
+
+    // Fused tonemapping like DoViTonemap, enabled by tonemapMaxNits. Negative master
+    // values are taken per frame from the RPU.
+    bool m_tonemap = false;
+    int m_tmMasterMaxPq = -1;
+    int m_tmMasterMinPq = -1;
+    float m_tmLumScale = 1.0f;
+    // EETF curves for the master ranges of the frames
+    std::unique_ptr<DoViEetfCache<16>> m_eetfCache;
+
+    // Fused cubes like DoViCubes, applied row by row after the tonemapping
+    std::unique_ptr<DoViCubeSet> m_cubes;
+    bool m_cubesFullrange = true;
+
+    // L5 active area: only the active area of every frame is rendered, the bars are filled with black.
+    // The output may be cropped to the union of the active areas of the clip.
+    bool m_activeArea = false;
+    std::array<int, 4> m_crop{}; // left, right, top, bottom
+
+    // Fused resize of the (cropped) RGB rows to the output size, before tonemapping and cubes
+    std::unique_ptr<DoViResampler> m_resampler;
+
+    // Filter of the EL and chroma upsampling of the full quality and preview modes
+    DoViUpsampler m_upsampler = DoViUpsampler::spline16;
+
+    // Per frame max(R, G, B) statistics of the RGB output, measured while it is written
+    bool m_measure = false;
+    // full range code of every limited range code, measured instead of the limited range rows
+    std::vector<uint16_t> m_measureLut;
+
+    // Output frames of earlier runs, only with cacheDir
+    std::unique_ptr<DoViDiskCache> m_diskCache;
+
+    // Composition shared with the other outputs of BakerMulti
+    std::shared_ptr<DoViComposeCache> m_composeCache;
+    int m_outputIndex = 0;
+
+    // Intra-frame parallelism, only created for threads > 1
+    std::unique_ptr<DoViStripeScheduler> m_scheduler;
+
     bool m_qnd;
+    bool m_preview;
     bool m_outYUV;
     bool m_blChromaSubSampled;
     bool m_elChromaSubSampled;
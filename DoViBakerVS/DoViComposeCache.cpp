@@ -0,0 +1,60 @@
+#include "DoViComposeCache.h"
+#include <algorithm>
+
+DoViComposeCache::DoViComposeCache(int outputs, size_t capacity)
+    : m_outputs(outputs)
+    , m_capacity(capacity)
+{
+}
+
+std::shared_ptr<DoViComposeCache::Entry> DoViComposeCache::acquire(int n)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& slot = m_entries[n];
+    if (!slot) {
+        slot = std::make_shared<Entry>();
+        slot->age = m_age++;
+        // frames still composing stay referenced by their outputs, dropping them is safe
+        while (m_entries.size() > m_capacity) {
+            auto oldest = std::min_element(m_entries.begin(), m_entries.end(),
+                [](const auto& a, const auto& b) { return a.second->age < b.second->age; });
+            m_entries.erase(oldest);
+        }
+    }
+    return slot;
+}
+
+void DoViComposeCache::release(int n, const std::shared_ptr<Entry>& entry)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (++entry->fetched >= m_outputs) {
+        auto it = m_entries.find(n);
+        if (it != m_entries.end() && it->second == entry) {
+            m_entries.erase(it);
+        }
+    }
+}
+
+ConstFrame DoViComposeCache::get(int n, const std::function<ConstFrame()>& compose)
+{
+    const std::shared_ptr<Entry> entry = acquire(n);
+    ConstFrame frame;
+    {
+        // a failed composition leaves the frame empty for the next output to try again
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        if (!entry->frame) {
+            entry->frame = compose();
+        }
+        frame = entry->frame;
+    }
+
+    release(n, entry);
+    return frame;
+}
+
+void DoViComposeCache::skip(int n)
+{
+    // the entry is made even if no other output has asked for the frame yet, so it is dropped
+    // once the remaining outputs have fetched it
+    release(n, acquire(n));
+}
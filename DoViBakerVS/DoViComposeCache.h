@@ -0,0 +1,73 @@
+#pragma once
+#include "VapourSynth4++.hpp"
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace vsxx4;
+
+// Composed BL / EL frames shared by the outputs of BakerMulti. The first output asking for a frame
+// composes it while the others wait for it, so the reshaping, NLQ and MMR work is done once per frame.
+// A frame is dropped as soon as every output has fetched it. Outputs that are not asked for every
+// frame would keep frames forever, so at most capacity frames are held and the oldest ones are dropped;
+// an output asking for a dropped frame composes it again.
+class DoViComposeCache {
+public:
+    DoViComposeCache(int outputs, size_t capacity);
+
+    // the composed frame n, made by compose if no other output has made it yet
+    ConstFrame get(int n, const std::function<ConstFrame()>& compose);
+
+    // counts frame n as fetched by an output that does not need it, e.g. one reading it from its disk cache
+    void skip(int n);
+
+private:
+    struct Entry;
+
+    // the entry of frame n, created if it is not held yet
+    std::shared_ptr<Entry> acquire(int n);
+    // counts entry as fetched once more and drops it when all outputs have fetched it
+    void release(int n, const std::shared_ptr<Entry>& entry);
+
+    struct Entry {
+        // held while the frame is composed
+        std::mutex mutex;
+        ConstFrame frame;
+        int fetched = 0;
+        uint64_t age = 0;
+    };
+
+    const int m_outputs;
+    const size_t m_capacity;
+    std::mutex m_mutex;
+    std::map<int, std::shared_ptr<Entry>> m_entries;
+    uint64_t m_age = 0;
+};
+
+// The claim of one output on frame n of a DoViComposeCache, if there is one. Unless the composed frame
+// is fetched through it, the frame is skipped when the claim goes out of scope, so an output returning
+// early or failing does not keep the composition of the other outputs alive.
+class DoViComposeClaim {
+public:
+    DoViComposeClaim(DoViComposeCache* cache, int n) : m_cache(cache), m_n(n) {}
+    ~DoViComposeClaim()
+    {
+        if (m_cache) {
+            m_cache->skip(m_n);
+        }
+    }
+    DoViComposeClaim(const DoViComposeClaim&) = delete;
+    DoViComposeClaim& operator=(const DoViComposeClaim&) = delete;
+
+    ConstFrame get(const std::function<ConstFrame()>& compose)
+    {
+        ConstFrame frame = m_cache->get(m_n, compose);
+        m_cache = nullptr;
+        return frame;
+    }
+
+private:
+    DoViComposeCache* m_cache;
+    const int m_n;
+};
@@ -0,0 +1,63 @@
+#include "DoViCubeSet.h"
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+DoViCubeSet::DoViCubeSet(const ConstMap& in, const timecube_filter_params& params, const std::string& filterName)
+{
+    // Get cube file paths and mcll thresholds
+    int numCubes = in.num_elements("cubes");
+    int numMclls = in.num_elements("mclls");
+
+    if (numCubes <= 0)
+        throw std::runtime_error(filterName + ": at least one cube file must be specified");
+
+    if (numCubes != numMclls)
+        throw std::runtime_error(filterName + ": number of cubes must match number of mclls");
+
+    // Get optional base path
+    std::string basePath;
+    if (in.contains("cubes_basepath")) {
+        basePath = in.get_prop<const char*>("cubes_basepath");
+        if (!basePath.empty() && basePath.back() != '/' && basePath.back() != '\\') {
+            basePath += '/';
+        }
+    }
+
+    // Load all LUTs
+    for (int i = 0; i < numCubes; ++i) {
+        const char* cubeName = in.get_prop<const char*>("cubes", i);
+        int64_t mcll = in.get_prop<int64_t>("mclls", i);
+
+        std::string cubePath = basePath + cubeName;
+
+        if (!std::filesystem::exists(std::filesystem::path(cubePath))) {
+            throw std::runtime_error(filterName + ": cannot find cube file " + cubePath);
+        }
+
+        std::unique_ptr<timecube_lut, TimecubeLutFree> cube{ timecube_lut_from_file(cubePath.c_str()) };
+        if (!cube) {
+            throw std::runtime_error(filterName + ": error reading LUT from file " + cubePath);
+        }
+
+        timecube_filter* filter = timecube_filter_create(cube.get(), &params);
+        if (!filter) {
+            throw std::runtime_error(filterName + ": error creating LUT from file " + cubePath);
+        }
+
+        m_tmpSize = std::max(m_tmpSize, timecube_filter_get_tmp_size(filter));
+        m_luts.emplace_back(static_cast<uint16_t>(mcll), std::unique_ptr<timecube_filter, TimecubeFilterFree>(filter));
+    }
+}
+
+const timecube_filter* DoViCubeSet::select(uint16_t maxCll) const
+{
+    const timecube_filter* selectedLut = m_luts.back().second.get();
+    for (size_t i = 1; i < m_luts.size(); ++i) {
+        if (maxCll <= m_luts[i].first) {
+            selectedLut = m_luts[i - 1].second.get();
+            break;
+        }
+    }
+    return selectedLut;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "VapourSynth4++.hpp"
+#include "timecube.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace vsxx4;
+
+// The cubes of the "cubes" argument with their max content light level thresholds from "mclls",
+// relative to the optional "cubes_basepath". Shared by DoViCubes and the fused cubes of DoViBaker.
+class DoViCubeSet {
+public:
+    // errors are reported prefixed by filterName
+    DoViCubeSet(const ConstMap& in, const timecube_filter_params& params, const std::string& filterName);
+
+    // the cube of the frame's max content light level
+    const timecube_filter* select(uint16_t maxCll) const;
+    // temporary buffer size sufficient for every cube
+    size_t tmpSize() const { return m_tmpSize; }
+
+private:
+    struct TimecubeLutFree {
+        void operator()(timecube_lut* ptr) { timecube_lut_free(ptr); }
+    };
+
+    struct TimecubeFilterFree {
+        void operator()(timecube_filter* ptr) { timecube_filter_free(ptr); }
+    };
+
+    std::vector<std::pair<uint16_t, std::unique_ptr<timecube_filter, TimecubeFilterFree>>> m_luts;
+    size_t m_tmpSize = 0;
+};
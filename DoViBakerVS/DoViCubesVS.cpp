@@ -1,9 +1,8 @@
 #include "DoViCubesVS.h"
+#include "DoViScratchArena.h"
 #include "VSHelper4.h"
 #include <stdexcept>
 #include <climits>
-#include <filesystem>
-#include <string>
 
 void DoViCubesVS::init(const ConstMap& in, const Map& out, const Core& core)
 {
@@ -21,25 +20,6 @@ void DoViCubesVS::init(const ConstMap& in, const Map& out, const Core& core)
 
     m_fullrange = in.get_prop<int64_t>("fullrange", map::default_val(1LL)) != 0;
 
-    // Get cube file paths and mcll thresholds
-    int numCubes = in.num_elements("cubes");
-    int numMclls = in.num_elements("mclls");
-
-    if (numCubes <= 0)
-        throw std::runtime_error("DoViCubes: at least one cube file must be specified");
-
-    if (numCubes != numMclls)
-        throw std::runtime_error("DoViCubes: number of cubes must match number of mclls");
-
-    // Get optional base path
-    std::string basePath;
-    if (in.contains("cubes_basepath")) {
-        basePath = in.get_prop<const char*>("cubes_basepath");
-        if (!basePath.empty() && basePath.back() != '/' && basePath.back() != '\\') {
-            basePath += '/';
-        }
-    }
-
     // Setup timecube parameters
     timecube_filter_params params{};
     params.width = static_cast<unsigned>(m_vi.width);
@@ -53,29 +33,7 @@ void DoViCubesVS::init(const ConstMap& in, const Map& out, const Core& core)
     params.interp = TIMECUBE_INTERP_TETRA;
     params.cpu = static_cast<timecube_cpu_type_e>(INT_MAX);
 
-    // Load all LUTs
-    for (int i = 0; i < numCubes; ++i) {
-        const char* cubeName = in.get_prop<const char*>("cubes", i);
-        int64_t mcll = in.get_prop<int64_t>("mclls", i);
-
-        std::string cubePath = basePath + cubeName;
-
-        if (!std::filesystem::exists(std::filesystem::path(cubePath))) {
-            throw std::runtime_error(std::string("DoViCubes: cannot find cube file ") + cubePath);
-        }
-
-        std::unique_ptr<timecube_lut, TimecubeLutFree> cube{ timecube_lut_from_file(cubePath.c_str()) };
-        if (!cube) {
-            throw std::runtime_error(std::string("DoViCubes: error reading LUT from file ") + cubePath);
-        }
-
-        timecube_filter* filter = timecube_filter_create(cube.get(), &params);
-        if (!filter) {
-            throw std::runtime_error(std::string("DoViCubes: error creating LUT from file ") + cubePath);
-        }
-
-        m_luts.emplace_back(static_cast<uint16_t>(mcll), std::unique_ptr<timecube_filter, TimecubeFilterFree>(filter));
-    }
+    m_cubes = std::make_unique<DoViCubeSet>(in, params, "DoViCubes");
 
     create_video_filter(out, m_vi, fmParallel, simple_dep(m_clip, rpStrictSpatial), core);
 }
@@ -100,13 +58,7 @@ ConstFrame DoViCubesVS::get_frame(int n, const Core& core, const FrameContext& f
     }
 
     // Select appropriate LUT based on maxCll
-    const timecube_filter* selectedLut = m_luts.back().second.get();
-    for (size_t i = 1; i < m_luts.size(); ++i) {
-        if (maxCll <= m_luts[i].first) {
-            selectedLut = m_luts[i - 1].second.get();
-            break;
-        }
-    }
+    const timecube_filter* selectedLut = m_cubes->select(maxCll);
 
     applyLut(dst, src, selectedLut);
 
@@ -127,8 +79,8 @@ void DoViCubesVS::applyLut(Frame& dst, const ConstFrame& src, const timecube_fil
         dst_stride[p] = dst.stride(p);
     }
 
-    std::unique_ptr<void, decltype(&vsh::vsh_aligned_free)> tmp{ nullptr, vsh::vsh_aligned_free };
-    tmp.reset(vsh::vsh_aligned_malloc(timecube_filter_get_tmp_size(lut), 64));
+    DoViScratchArena::Scope scratch;
+    void* tmp = DoViScratchArena::take<uint8_t>(timecube_filter_get_tmp_size(lut));
 
-    timecube_filter_apply(lut, src_p, src_stride, dst_p, dst_stride, tmp.get());
+    timecube_filter_apply(lut, src_p, src_stride, dst_p, dst_stride, tmp);
 }
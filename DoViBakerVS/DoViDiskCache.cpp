@@ -0,0 +1,302 @@
+#include "DoViDiskCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[4] = { 'D', 'V', 'B', 'C' };
+// 2: the statistics of limited range output are measured in full range
+constexpr uint32_t kVersion = 2;
+constexpr int kLoadsBeforeBypass = 8;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t planes;
+    uint32_t bytesPerSample;
+    uint32_t hasStats;
+    uint32_t renderMicros;
+    uint64_t rpuHash;
+};
+
+struct PlaneHeader {
+    int32_t width;
+    int32_t height;
+    uint64_t size;
+};
+
+// Residuals against the sample above, or to the left in the first row, are zigzag coded so small negative
+// ones stay small. Blocks of 16 of them are packed with the bit width of the largest one, given in a leading
+// byte; blocks not getting smaller than the samples themselves, like noise, keep the samples instead.
+constexpr int kBlock = 16;
+
+template <typename T>
+void encodePlane(std::vector<uint8_t>& out, const uint8_t* src, ptrdiff_t stride, int width, int height)
+{
+    using S = std::make_signed_t<T>;
+    constexpr int sampleBits = 8 * sizeof(T);
+    std::vector<uint64_t> residuals((width + kBlock - 1) / kBlock * kBlock, 0);
+    for (int y = 0; y < height; y++) {
+        const T* row = reinterpret_cast<const T*>(src + y * stride);
+        const T* above = y ? reinterpret_cast<const T*>(src + (y - 1) * stride) : nullptr;
+        for (int x = 0; x < width; x++) {
+            const T pred = above ? above[x] : (x ? row[x - 1] : 0);
+            const int64_t residual = static_cast<S>(static_cast<T>(row[x] - pred));
+            residuals[x] = residual >= 0 ? 2 * static_cast<uint64_t>(residual) : 2 * static_cast<uint64_t>(-residual) - 1;
+        }
+        for (int x = 0; x < width; x += kBlock) {
+            const int count = std::min(kBlock, width - x);
+            uint64_t all = 0;
+            for (int i = 0; i < count; i++) {
+                all |= residuals[x + i];
+            }
+            int bits = 0;
+            while (all >> bits) {
+                bits++;
+            }
+            const bool raw = bits >= sampleBits;
+            out.push_back(static_cast<uint8_t>(raw ? sampleBits : bits));
+            if (raw) {
+                bits = sampleBits;
+            }
+            uint64_t acc = 0;
+            int filled = 0;
+            for (int i = 0; i < kBlock; i++) {
+                const uint64_t v = i >= count ? 0 : raw ? row[x + i] : residuals[x + i];
+                acc |= v << filled;
+                filled += bits;
+                for (; filled >= 8; filled -= 8, acc >>= 8) {
+                    out.push_back(static_cast<uint8_t>(acc));
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+bool decodePlane(uint8_t* dst, ptrdiff_t stride, int width, int height, const uint8_t* src, const uint8_t* end)
+{
+    constexpr int sampleBits = 8 * sizeof(T);
+    uint64_t values[kBlock];
+    for (int y = 0; y < height; y++) {
+        T* row = reinterpret_cast<T*>(dst + y * stride);
+        const T* above = y ? reinterpret_cast<const T*>(dst + (y - 1) * stride) : nullptr;
+        for (int x = 0; x < width; x += kBlock) {
+            if (src == end) {
+                return false;
+            }
+            const int bits = *src++;
+            // 16 values of bits each fill exactly 2 * bits bytes
+            if (bits > sampleBits || end - src < 2 * bits) {
+                return false;
+            }
+            const uint64_t mask = (uint64_t(1) << bits) - 1;
+            uint64_t acc = 0;
+            int filled = 0;
+            for (int i = 0; i < kBlock; i++) {
+                for (; filled < bits; filled += 8) {
+                    acc |= static_cast<uint64_t>(*src++) << filled;
+                }
+                values[i] = acc & mask;
+                acc >>= bits;
+                filled -= bits;
+            }
+
+            const int count = std::min(kBlock, width - x);
+            T* out = row + x;
+            if (bits == sampleBits) {
+                for (int i = 0; i < count; i++) {
+                    out[i] = static_cast<T>(values[i]);
+                }
+                continue;
+            }
+            for (int i = 0; i < count; i++) {
+                const uint64_t z = values[i];
+                const T residual = static_cast<T>((z & 1) ? ~(z >> 1) : (z >> 1));
+                const T pred = above ? above[x + i] : (x + i ? out[i - 1] : 0);
+                out[i] = static_cast<T>(pred + residual);
+            }
+        }
+    }
+    return src == end;
+}
+}
+
+DoViDiskCache::DoViDiskCache(const std::string& dir, const std::string& key)
+{
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash(key.data(), key.size())));
+    m_dir = std::filesystem::path(dir) / name;
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_dir, ec);
+    if (ec) {
+        throw std::runtime_error("DoViBaker: cannot create cacheDir " + m_dir.string() + ": " + ec.message());
+    }
+    // the key in plain text, to tell the directories apart
+    const std::filesystem::path keyPath = m_dir / "key.txt";
+    if (!std::filesystem::exists(keyPath)) {
+        std::ofstream(keyPath, std::ios::binary) << key;
+    }
+}
+
+uint64_t DoViDiskCache::hash(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        seed = (seed ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return seed;
+}
+
+std::filesystem::path DoViDiskCache::framePath(int n) const
+{
+    return m_dir / (std::to_string(n) + ".dvbc");
+}
+
+bool DoViDiskCache::load(int n, uint64_t rpuHash, Frame& dst, DoViRgbStats* stats)
+{
+    if (m_bypass) {
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    int64_t renderMicros = 0;
+    if (!read(n, rpuHash, dst, stats, renderMicros)) {
+        return false;
+    }
+
+    // after a few frames, stop reading if it takes longer than rendering did
+    const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    m_loadMicros += micros;
+    m_renderMicros += renderMicros;
+    if (++m_loads >= kLoadsBeforeBypass && m_loadMicros > m_renderMicros) {
+        m_bypass = true;
+    }
+    return true;
+}
+
+bool DoViDiskCache::read(int n, uint64_t rpuHash, Frame& dst, DoViRgbStats* stats, int64_t& renderMicros)
+{
+    std::ifstream file(framePath(n), std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(data.data()), data.size())) {
+        return false;
+    }
+
+    const uint8_t* pos = data.data();
+    const uint8_t* end = pos + data.size();
+    FileHeader header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, pos, sizeof(header));
+    pos += sizeof(header);
+    const int planes = dst.format().numPlanes;
+    const int bytesPerSample = dst.format().bytesPerSample;
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) || header.version != kVersion || header.planes != static_cast<uint32_t>(planes) ||
+        header.bytesPerSample != static_cast<uint32_t>(bytesPerSample) || header.rpuHash != rpuHash || (stats && !header.hasStats)) {
+        return false;
+    }
+    renderMicros = header.renderMicros;
+    if (header.hasStats) {
+        if (static_cast<size_t>(end - pos) < sizeof(DoViRgbStats)) {
+            return false;
+        }
+        if (stats) {
+            std::memcpy(stats, pos, sizeof(DoViRgbStats));
+        }
+        pos += sizeof(DoViRgbStats);
+    }
+
+    for (int p = 0; p < planes; p++) {
+        PlaneHeader plane;
+        if (static_cast<size_t>(end - pos) < sizeof(plane)) {
+            return false;
+        }
+        std::memcpy(&plane, pos, sizeof(plane));
+        pos += sizeof(plane);
+        if (plane.width != dst.width(p) || plane.height != dst.height(p) || plane.size > static_cast<uint64_t>(end - pos)) {
+            return false;
+        }
+        const uint8_t* planeEnd = pos + plane.size;
+        const bool decoded = bytesPerSample == 1 ? decodePlane<uint8_t>(dst.write_ptr(p), dst.stride(p), plane.width, plane.height, pos, planeEnd)
+            : bytesPerSample == 2 ? decodePlane<uint16_t>(dst.write_ptr(p), dst.stride(p), plane.width, plane.height, pos, planeEnd)
+            : decodePlane<uint32_t>(dst.write_ptr(p), dst.stride(p), plane.width, plane.height, pos, planeEnd);
+        if (!decoded) {
+            return false;
+        }
+        pos = planeEnd;
+    }
+    return pos == end;
+}
+
+void DoViDiskCache::store(int n, uint64_t rpuHash, const Frame& frame, const DoViRgbStats* stats, int64_t renderMicros) const
+{
+    if (m_bypass) {
+        return;
+    }
+    const int planes = frame.format().numPlanes;
+    const int bytesPerSample = frame.format().bytesPerSample;
+    std::vector<uint8_t> data(sizeof(FileHeader));
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.planes = planes;
+    header.bytesPerSample = bytesPerSample;
+    header.hasStats = stats ? 1 : 0;
+    header.renderMicros = static_cast<uint32_t>(std::clamp<int64_t>(renderMicros, 0, std::numeric_limits<uint32_t>::max()));
+    header.rpuHash = rpuHash;
+    std::memcpy(data.data(), &header, sizeof(header));
+    if (stats) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(stats);
+        data.insert(data.end(), bytes, bytes + sizeof(DoViRgbStats));
+    }
+
+    for (int p = 0; p < planes; p++) {
+        const size_t planeStart = data.size();
+        data.resize(planeStart + sizeof(PlaneHeader));
+        const int width = frame.width(p);
+        const int height = frame.height(p);
+        if (bytesPerSample == 1) {
+            encodePlane<uint8_t>(data, frame.read_ptr(p), frame.stride(p), width, height);
+        } else if (bytesPerSample == 2) {
+            encodePlane<uint16_t>(data, frame.read_ptr(p), frame.stride(p), width, height);
+        } else {
+            encodePlane<uint32_t>(data, frame.read_ptr(p), frame.stride(p), width, height);
+        }
+        const PlaneHeader plane{ width, height, data.size() - planeStart - sizeof(PlaneHeader) };
+        std::memcpy(data.data() + planeStart, &plane, sizeof(plane));
+    }
+
+    // written under a name of its own and renamed, so concurrent runs and crashes never leave a partial frame
+    const std::filesystem::path path = framePath(n);
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+        static_cast<size_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    {
+        std::ofstream file(tmpPath, std::ios::binary);
+        if (!file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+            file.close();
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+    }
+}
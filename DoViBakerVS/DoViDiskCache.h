@@ -0,0 +1,42 @@
+#pragma once
+#include "VapourSynth4++.hpp"
+#include "DoViKernels.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+using namespace vsxx4;
+
+// Output frames of Baker kept on disk, so later runs of the same script skip the rendering.
+// The frames of one filter configuration live in a directory named after the hash of its key, which
+// describes the arguments, the sources and the RPU file. Every frame is a file of its own that also holds
+// the hash of the RPU of the frame, so frames of integrated RPUs are checked as well.
+// The samples are stored losslessly as packed residuals against their neighbours. Every file holds the
+// time its frame took to render; once reading frames turns out slower than rendering them, e.g. on a slow
+// disk, the cache is bypassed. Broken or mismatching files count as missing and are written again.
+class DoViDiskCache {
+public:
+    // creates the directory of the key below dir
+    DoViDiskCache(const std::string& dir, const std::string& key);
+
+    // reads frame n into dst, false if there is no usable file or the cache is bypassed. With stats
+    // the file has to hold the measured statistics too.
+    bool load(int n, uint64_t rpuHash, Frame& dst, DoViRgbStats* stats);
+    // writes frame n which took renderMicros to render, failing to do so only leaves the frame missing
+    void store(int n, uint64_t rpuHash, const Frame& frame, const DoViRgbStats* stats, int64_t renderMicros) const;
+
+    // FNV-1a of the data, continuing from seed
+    static uint64_t hash(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ULL);
+
+private:
+    std::filesystem::path framePath(int n) const;
+    bool read(int n, uint64_t rpuHash, Frame& dst, DoViRgbStats* stats, int64_t& renderMicros);
+
+    std::filesystem::path m_dir;
+    // time taken to read the loaded frames and to render them in the run that stored them
+    std::atomic<int64_t> m_loadMicros{ 0 };
+    std::atomic<int64_t> m_renderMicros{ 0 };
+    std::atomic<int> m_loads{ 0 };
+    std::atomic<bool> m_bypass{ false };
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include "DoViEetf.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// EETF curves of one filter, keyed by the master range, the luminosity scale and the input range of the
+// frames. The curves are immutable once generated, so frames of one scene share a curve and frames of
+// different scenes processed in parallel each get their own instead of regenerating a single one. Only the
+// lookup is locked, the curves are generated outside the lock and the least recently used ones are dropped
+// beyond the capacity.
+template <int signalBitDepth>
+class DoViEetfCache {
+public:
+    DoViEetfCache(uint16_t targetMaxPq, uint16_t targetMinPq, float kneeOffset, bool normalizeOutput, size_t capacity = 8)
+        : m_targetMaxPq(targetMaxPq)
+        , m_targetMinPq(targetMinPq)
+        , m_kneeOffset(kneeOffset)
+        , m_normalizeOutput(normalizeOutput)
+        , m_capacity(capacity)
+    {
+    }
+
+    // the curve of the given master range, luminosity scale and input range, generated on first use
+    std::shared_ptr<const DoViEetf<signalBitDepth>> get(uint16_t masterMaxPq, uint16_t masterMinPq, float lumScale, bool limitedInput)
+    {
+        const Key key{ masterMaxPq, masterMinPq, lumScale, limitedInput };
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (auto eetf = find(key)) {
+                return eetf;
+            }
+        }
+        // concurrent frames of a new scene may both generate it, the first one inserted is kept
+        auto eetf = std::make_shared<DoViEetf<signalBitDepth>>(m_kneeOffset, m_normalizeOutput);
+        eetf->generateEETF(m_targetMaxPq, m_targetMinPq, masterMaxPq, masterMinPq, lumScale, limitedInput);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (auto existing = find(key)) {
+            return existing;
+        }
+        m_entries.emplace_front(key, eetf);
+        if (m_entries.size() > m_capacity) {
+            m_entries.pop_back();
+        }
+        return eetf;
+    }
+
+private:
+    struct Key {
+        uint16_t masterMaxPq;
+        uint16_t masterMinPq;
+        float lumScale;
+        bool limitedInput;
+        bool operator==(const Key&) const = default;
+    };
+
+    // the cached curve of key, moved to the front as the most recently used one
+    std::shared_ptr<const DoViEetf<signalBitDepth>> find(const Key& key)
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->first == key) {
+                m_entries.splice(m_entries.begin(), m_entries, it);
+                return it->second;
+            }
+        }
+        return nullptr;
+    }
+
+    const uint16_t m_targetMaxPq;
+    const uint16_t m_targetMinPq;
+    const float m_kneeOffset;
+    const bool m_normalizeOutput;
+    const size_t m_capacity;
+    std::mutex m_mutex;
+    // most recently used first
+    std::list<std::pair<Key, std::shared_ptr<const DoViEetf<signalBitDepth>>>> m_entries;
+};
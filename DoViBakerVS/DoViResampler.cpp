@@ -0,0 +1,147 @@
+#include "DoViResampler.h"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+namespace {
+
+double bilinear(double x)
+{
+    return std::max(1 - x, 0.0);
+}
+
+// Mitchell-Netravali, b = c = 1/3 like the default of resize.Bicubic
+double bicubic(double x)
+{
+    if (x < 1)
+        return ((7 * x - 12) * x * x + 16.0 / 3) / 6;
+    if (x < 2)
+        return (((-7.0 / 3 * x + 12) * x - 20) * x + 32.0 / 3) / 6;
+    return 0;
+}
+
+double spline16(double x)
+{
+    if (x < 1)
+        return ((x - 9.0 / 5) * x - 1.0 / 5) * x + 1;
+    x -= 1;
+    if (x < 1)
+        return ((-1.0 / 3 * x + 4.0 / 5) * x - 7.0 / 15) * x;
+    return 0;
+}
+
+double spline36(double x)
+{
+    if (x < 1)
+        return ((13.0 / 11 * x - 453.0 / 209) * x - 3.0 / 209) * x + 1;
+    x -= 1;
+    if (x < 1)
+        return ((-6.0 / 11 * x + 270.0 / 209) * x - 156.0 / 209) * x;
+    x -= 1;
+    if (x < 1)
+        return ((1.0 / 11 * x - 45.0 / 209) * x + 26.0 / 209) * x;
+    return 0;
+}
+
+double lanczos3(double x)
+{
+    if (x == 0)
+        return 1;
+    if (x >= 3)
+        return 0;
+    const double px = std::numbers::pi * x;
+    return 3 * std::sin(px) * std::sin(px / 3) / (px * px);
+}
+
+}
+
+DoViResampler::DoViResampler(int srcWidth, int srcHeight, int dstWidth, int dstHeight, const std::string& kernel)
+    : m_srcWidth(srcWidth)
+    , m_srcHeight(srcHeight)
+{
+    struct Kernel {
+        const char* name;
+        double support;
+        double (*fn)(double);
+    };
+    static constexpr Kernel kernels[] = {
+        { "bilinear", 1, bilinear },
+        { "bicubic", 2, bicubic },
+        { "spline16", 2, spline16 },
+        { "spline36", 3, spline36 },
+        { "lanczos", 3, lanczos3 },
+    };
+
+    auto it = std::find_if(std::begin(kernels), std::end(kernels), [&](const Kernel& k) { return kernel == k.name; });
+    if (it == std::end(kernels)) {
+        throw std::runtime_error("DoViBaker: resizeKernel must be bilinear, bicubic, spline16, spline36 or lanczos");
+    }
+    m_horz = makeAxis(srcWidth, dstWidth, it->support, it->fn);
+    m_vert = makeAxis(srcHeight, dstHeight, it->support, it->fn);
+}
+
+DoViResampler::Axis DoViResampler::makeAxis(int srcSize, int dstSize, double support, double (*kernel)(double))
+{
+    // the kernel is stretched when downscaling, so every source sample contributes
+    const double scale = static_cast<double>(dstSize) / srcSize;
+    const double filterScale = std::min(scale, 1.0);
+    const double reach = support / filterScale;
+
+    Axis axis;
+    axis.taps = std::min(static_cast<int>(std::ceil(2 * reach)), srcSize);
+    axis.left.resize(dstSize);
+    axis.weights.assign(static_cast<size_t>(dstSize) * axis.taps, 0.0f);
+
+    std::vector<double> weights;
+    for (int x = 0; x < dstSize; x++) {
+        const double center = (x + 0.5) / scale - 0.5;
+        const int first = static_cast<int>(std::floor(center - reach)) + 1;
+        const int last = static_cast<int>(std::ceil(center + reach)) - 1;
+
+        // positions beyond the edges are clamped, their weights land on the edge samples of the window
+        const int left = std::clamp(first, 0, srcSize - axis.taps);
+        weights.assign(axis.taps, 0.0);
+        double sum = 0;
+        for (int pos = first; pos <= last; pos++) {
+            const double w = kernel(std::abs(pos - center) * filterScale);
+            weights[std::clamp(pos, 0, srcSize - 1) - left] += w;
+            sum += w;
+        }
+
+        axis.left[x] = left;
+        float* dst = axis.weights.data() + static_cast<size_t>(x) * axis.taps;
+        for (int i = 0; i < axis.taps; i++) {
+            dst[i] = static_cast<float>(weights[i] / sum);
+        }
+    }
+    return axis;
+}
+
+void DoViResampler::resampleRow(float* dst, const uint16_t* src) const
+{
+    const int taps = m_horz.taps;
+    const float* weights = m_horz.weights.data();
+    for (int x = 0; x < dstWidth(); x++, weights += taps) {
+        const uint16_t* srcX = src + m_horz.left[x];
+        float sum = 0;
+        for (int i = 0; i < taps; i++) {
+            sum += weights[i] * srcX[i];
+        }
+        dst[x] = sum;
+    }
+}
+
+void DoViResampler::resampleColumn(uint16_t* dst, const float* const* rows, int y) const
+{
+    const int taps = m_vert.taps;
+    const float* weights = m_vert.weights.data() + static_cast<size_t>(y) * taps;
+    const int width = dstWidth();
+    for (int x = 0; x < width; x++) {
+        float sum = 0;
+        for (int i = 0; i < taps; i++) {
+            sum += weights[i] * rows[i][x];
+        }
+        dst[x] = static_cast<uint16_t>(std::clamp(sum + 0.5f, 0.0f, 65535.0f));
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Separable resampling of 16 bit rows to another size, for the fused resize of DoViBaker.
+// The filter weights of every output row and column are computed once. Output pixel centers map to
+// source pixel centers like with the VapourSynth resizers, source positions beyond the edges are clamped.
+// Rows are resampled horizontally into floats first, the vertical pass then rounds to 16 bit.
+class DoViResampler {
+public:
+    // kernel is one of "bilinear", "bicubic", "spline16", "spline36" or "lanczos"
+    DoViResampler(int srcWidth, int srcHeight, int dstWidth, int dstHeight, const std::string& kernel);
+
+    int srcWidth() const { return m_srcWidth; }
+    int srcHeight() const { return m_srcHeight; }
+    int dstWidth() const { return static_cast<int>(m_horz.left.size()); }
+    int dstHeight() const { return static_cast<int>(m_vert.left.size()); }
+
+    // output row y is made of the source rows [firstRow(y), lastRow(y)], both grow with y
+    int firstRow(int y) const { return m_vert.left[y]; }
+    int lastRow(int y) const { return m_vert.left[y] + m_vert.taps - 1; }
+    int verticalTaps() const { return m_vert.taps; }
+
+    // horizontal pass of a source row into dstWidth floats
+    void resampleRow(float* dst, const uint16_t* src) const;
+    // vertical pass of output row y, rows[i] being the horizontally resampled source row firstRow(y) + i
+    void resampleColumn(uint16_t* dst, const float* const* rows, int y) const;
+
+private:
+    // taps weights per output position, applied to the source positions starting at left
+    struct Axis {
+        int taps = 0;
+        std::vector<int> left;
+        std::vector<float> weights;
+    };
+
+    static Axis makeAxis(int srcSize, int dstSize, double support, double (*kernel)(double));
+
+    int m_srcWidth;
+    int m_srcHeight;
+    Axis m_horz;
+    Axis m_vert;
+};
@@ -0,0 +1,81 @@
+#include "DoViScratchArena.h"
+#include "VSHelper4.h"
+#include <algorithm>
+#include <new>
+
+DoViScratchArena::Scope::Scope()
+    : m_arena(local())
+    , m_block(m_arena.m_current)
+    , m_used(m_arena.m_blocks.empty() ? 0 : m_arena.m_blocks[m_arena.m_current].used)
+{
+    m_arena.m_depth++;
+}
+
+DoViScratchArena::Scope::~Scope()
+{
+    DoViScratchArena& arena = m_arena;
+    if (--arena.m_depth > 0) {
+        arena.m_current = m_block;
+        if (!arena.m_blocks.empty())
+            arena.m_blocks[m_block].used = m_used;
+        return;
+    }
+
+    // merge the blocks of the frame into one large enough for all of them
+    if (arena.m_blocks.size() > 1) {
+        size_t total = 0;
+        for (const Block& block : arena.m_blocks)
+            total += block.size;
+        arena.m_blocks.clear();
+        arena.addBlock(total);
+    }
+    arena.m_current = 0;
+    if (!arena.m_blocks.empty())
+        arena.m_blocks[0].used = 0;
+}
+
+void DoViScratchArena::AlignedFree::operator()(uint8_t* ptr)
+{
+    vsh::vsh_aligned_free(ptr);
+}
+
+DoViScratchArena& DoViScratchArena::local()
+{
+    thread_local DoViScratchArena arena;
+    return arena;
+}
+
+void* DoViScratchArena::allocate(size_t bytes)
+{
+    bytes = (std::max<size_t>(bytes, 1) + alignment - 1) & ~(alignment - 1);
+    if (!m_blocks.empty() && m_blocks[m_current].size - m_blocks[m_current].used < bytes) {
+        // continue in the next block if there is one with enough space, it is unused past the current one
+        if (m_current + 1 < m_blocks.size() && m_blocks[m_current + 1].size >= bytes) {
+            m_current++;
+            m_blocks[m_current].used = 0;
+        } else {
+            // blocks after the current one hold nothing alive, replace them
+            const size_t size = std::max(bytes, m_blocks[m_current].size);
+            m_blocks.resize(m_current + 1);
+            addBlock(size);
+            m_current++;
+        }
+    } else if (m_blocks.empty()) {
+        addBlock(std::max<size_t>(bytes, 1 << 16));
+    }
+
+    Block& block = m_blocks[m_current];
+    void* ptr = block.data.get() + block.used;
+    block.used += bytes;
+    return ptr;
+}
+
+void DoViScratchArena::addBlock(size_t size)
+{
+    Block block;
+    block.data.reset(static_cast<uint8_t*>(vsh::vsh_aligned_malloc(size, alignment)));
+    if (!block.data)
+        throw std::bad_alloc();
+    block.size = size;
+    m_blocks.push_back(std::move(block));
+}
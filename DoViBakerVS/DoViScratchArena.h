@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Per thread scratch memory for the intermediate rows and temporary buffers of a frame.
+// Allocations are bump allocated and released all at once when the Scope they were made in
+// ends, the memory itself stays with the thread for the next frame. Blocks added while a frame
+// runs out of space are merged into one block when the outermost Scope ends, so after the
+// first frame every frame of the same size is served from a single block without touching the heap.
+class DoViScratchArena {
+public:
+    static constexpr size_t alignment = 64;
+
+    // Releases everything allocated on the calling thread since its construction when destroyed
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        DoViScratchArena& m_arena;
+        size_t m_block;
+        size_t m_used;
+    };
+
+    // count uninitialized elements, aligned to 64 bytes, valid until the innermost Scope ends
+    template <typename T>
+    static T* take(size_t count) { return static_cast<T*>(local().allocate(count * sizeof(T))); }
+
+private:
+    struct AlignedFree {
+        void operator()(uint8_t* ptr);
+    };
+
+    struct Block {
+        std::unique_ptr<uint8_t, AlignedFree> data;
+        size_t size = 0;
+        size_t used = 0;
+    };
+
+    static DoViScratchArena& local();
+    void* allocate(size_t bytes);
+    void addBlock(size_t size);
+
+    std::vector<Block> m_blocks;
+    size_t m_current = 0;
+    int m_depth = 0;
+};
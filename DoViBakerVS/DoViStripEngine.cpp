@@ -0,0 +1,511 @@
+#include "DoViStripEngine.h"
+#include "DoViDither.h"
+#include <algorithm>
+
+// Filters two rows down to half width at the top left chroma positions, [1 2 1] horizontally and
+// averaged vertically, with the outer taps folded back at the left and right edges
+static void filterDown2x(uint16_t* dst, const uint16_t* row0, const uint16_t* row1, int dstWidth)
+{
+    auto filter = [&](int x, int sum0, int sum1) {
+        dst[x] = ((sum0 >> 2) + (sum1 >> 2) + 1) >> 1;
+    };
+
+    filter(0, 3 * row0[0] + row0[1] + 2, 3 * row1[0] + row1[1] + 2);
+    for (int x = 1; x < dstWidth - 1; x++) {
+        filter(x,
+            row0[2 * x - 1] + 2 * row0[2 * x] + row0[2 * x + 1] + 2,
+            row1[2 * x - 1] + 2 * row1[2 * x] + row1[2 * x + 1] + 2);
+    }
+    const int last = dstWidth - 1;
+    filter(last, row0[2 * last - 1] + 3 * row0[2 * last] + 2, row1[2 * last - 1] + 3 * row1[2 * last] + 2);
+}
+
+void DoViRowRing::reset(int width)
+{
+    uint16_t* buffer = DoViScratchArena::take<uint16_t>(static_cast<size_t>(width) * slots);
+    for (int i = 0; i < slots; i++) {
+        m_rows[i] = buffer + static_cast<size_t>(width) * i;
+        m_rowIdx[i] = -1;
+    }
+}
+
+uint16_t* DoViRowRing::claim(int y)
+{
+    m_rowIdx[y & (slots - 1)] = y;
+    return m_rows[y & (slots - 1)];
+}
+
+DoViFrameRows::DoViFrameRows(const ConstFrame& frame)
+    : DoViFrameRows(frame, 0, frame.width(0))
+{
+}
+
+DoViFrameRows::DoViFrameRows(const ConstFrame& frame, int left, int right)
+{
+    for (int p = 0; p < 3; p++) {
+        const int shift = frame.width(p) < frame.width(0) ? 1 : 0;
+        const int leftP = left >> shift;
+        m_ptr[p] = reinterpret_cast<const uint16_t*>(frame.read_ptr(p)) + leftP;
+        m_pitch[p] = frame.stride(p) / sizeof(uint16_t);
+        m_width[p] = right >= frame.width(0) ? frame.width(p) - leftP : (right - left) >> shift;
+        m_height[p] = frame.height(p);
+    }
+}
+
+DoViComposedRows::DoViComposedRows(DoViRowSource& bl, DoViRowSource& el, bool chromaSubsampling, const DoViProcessor& proc)
+    : m_bl(bl)
+    , m_el(el)
+    , m_proc(proc)
+    , m_chromaSubsampling(chromaSubsampling)
+{
+    for (int p = 0; p < 3; p++) {
+        m_width[p] = bl.width(p);
+        m_height[p] = bl.height(p);
+        m_rings[p].reset(m_width[p]);
+    }
+    m_mmrRow = DoViScratchArena::take<uint16_t>(m_width[1]);
+}
+
+const uint16_t* DoViComposedRows::row(int plane, int y)
+{
+    if (const uint16_t* cached = m_rings[plane].find(y))
+        return cached;
+
+    if (plane != 0) {
+        composeChroma(y);
+        return m_rings[plane].find(y);
+    }
+
+    uint16_t* dstY = m_rings[0].claim(y);
+    m_proc.processRowY(dstY, m_bl.row(0, y), m_el.row(0, y), m_width[0]);
+    return dstY;
+}
+
+void DoViComposedRows::composeChroma(int huv)
+{
+    const int widthUV = m_width[1];
+    const uint16_t* blU = m_bl.row(1, huv);
+    const uint16_t* blV = m_bl.row(2, huv);
+    const uint16_t* elU = m_el.row(1, huv);
+    const uint16_t* elV = m_el.row(2, huv);
+    uint16_t* dstU = m_rings[1].claim(huv);
+    uint16_t* dstV = m_rings[2].claim(huv);
+
+    const uint16_t* mmrBlY = m_bl.row(0, huv);
+    if (m_chromaSubsampling) {
+        // the MMR luma input is the BL luma filtered down to the chroma position
+        filterDown2x(m_mmrRow, m_bl.row(0, 2 * huv), m_bl.row(0, 2 * huv + 1), widthUV);
+        mmrBlY = m_mmrRow;
+    }
+
+    m_proc.processRowU(dstU, blU, blV, elU, mmrBlY, 1, widthUV);
+    m_proc.processRowV(dstV, blU, blV, elV, mmrBlY, 1, widthUV);
+}
+
+DoViUpscaled2xRows::DoViUpscaled2xRows(DoViRowSource& src, bool withLuma, DoViUpsampler upsampler)
+    : m_src(src)
+{
+    const DoViKernels& kernels = DoViKernels::get();
+    switch (upsampler) {
+    case DoViUpsampler::nearest:
+        m_horz = { kernels.replicate2x, kernels.replicate2x };
+        break;
+    case DoViUpsampler::bilinear:
+        m_vert = { kernels.upsampleLumaVertBilinear, kernels.upsampleChromaVertBilinear };
+        m_horz = { kernels.upsampleLumaHorzBilinear, kernels.upsampleChromaHorzBilinear };
+        break;
+    case DoViUpsampler::spline16:
+        m_vert = { kernels.upsampleLumaVert, kernels.upsampleChromaVert };
+        m_horz = { kernels.upsampleLumaHorz, kernels.upsampleChromaHorz };
+        break;
+    }
+
+    int maxWidth = 0;
+    for (int p = withLuma ? 0 : 1; p < 3; p++) {
+        m_width[p] = 2 * src.width(p);
+        m_height[p] = 2 * src.height(p);
+        m_rings[p].reset(m_width[p]);
+        maxWidth = std::max(maxWidth, src.width(p));
+    }
+    m_vertRow = DoViScratchArena::take<uint16_t>(maxWidth);
+}
+
+const uint16_t* DoViUpscaled2xRows::row(int plane, int y)
+{
+    if (const uint16_t* cached = m_rings[plane].find(y))
+        return cached;
+
+    const bool luma = plane == 0;
+    const int srcWidth = m_src.width(plane);
+    const int srcHeight = m_src.height(plane);
+    const int h0 = y >> 1;
+    const bool odd = y & 1;
+    const HorzKernel horz = m_horz[luma ? 0 : 1];
+    const VertKernel vert = m_vert[luma ? 0 : 1];
+    if (!vert) {
+        // nearest: both output rows come from the source row as it is
+        uint16_t* dst = m_rings[plane].claim(y);
+        horz(dst, m_src.row(plane, h0), srcWidth);
+        return dst;
+    }
+
+    // 5 taps centered on the third row for luma, 4 taps centered on the second row for chroma
+    const int nD = luma ? 2 : 1;
+    const int vertLen = luma ? 5 : 4;
+    std::array<const uint16_t*, 5> srcP;
+    for (int i = 0; i < vertLen; i++) {
+        srcP[i] = m_src.row(plane, std::clamp(h0 + i - nD, 0, srcHeight - 1));
+    }
+
+    // vertical pass into a single row at source width, then the horizontal pass
+    uint16_t* dst = m_rings[plane].claim(y);
+    vert(m_vertRow, srcP.data(), srcWidth, odd);
+    horz(dst, m_vertRow, srcWidth);
+    return dst;
+}
+
+DoViChroma444Rows::DoViChroma444Rows(DoViRowSource& src, DoViUpsampler upsampler)
+    : m_src(src)
+    , m_chroma(src, false, upsampler)
+{
+    for (int p = 0; p < 3; p++) {
+        m_width[p] = p ? m_chroma.width(p) : src.width(0);
+        m_height[p] = p ? m_chroma.height(p) : src.height(0);
+    }
+}
+
+DoViHalfResRows::DoViHalfResRows(DoViRowSource& src)
+    : m_src(src)
+    , m_chromaSubsampling(src.width(1) < src.width(0))
+{
+    for (int p = 0; p < 3; p++) {
+        m_width[p] = (src.width(0) + 1) >> 1;
+        m_height[p] = (src.height(0) + 1) >> 1;
+        m_rings[p].reset(m_width[p]);
+    }
+}
+
+const uint16_t* DoViHalfResRows::row(int plane, int y)
+{
+    if (plane && m_chromaSubsampling)
+        return m_src.row(plane, y);
+    if (const uint16_t* cached = m_rings[plane].find(y))
+        return cached;
+
+    uint16_t* dst = m_rings[plane].claim(y);
+    const int y1 = std::min(2 * y + 1, m_src.height(plane) - 1);
+    filterDown2x(dst, m_src.row(plane, 2 * y), m_src.row(plane, y1), m_width[plane]);
+    return dst;
+}
+
+DoViRgbRows::DoViRgbRows(Frame& dst, int width, int height, const DoViRgbOutput& output)
+    : m_dst(dst)
+    , m_kernels(DoViKernels::get())
+    , m_output(output)
+    , m_width(width)
+    , m_cropWidth(output.resampler ? output.resampler->srcWidth() : dst.width(0))
+    , m_cropHeight(output.resampler ? output.resampler->srcHeight() : dst.height(0))
+{
+    const bool cropped = width != m_cropWidth || height != m_cropHeight;
+    const bool converted = m_output.cube || m_output.floatLut || m_output.halfLut || m_output.ditherThresholds;
+    if (converted || cropped || m_output.resampler) {
+        for (auto& r : m_rows) {
+            r = DoViScratchArena::take<uint16_t>(width);
+        }
+    }
+    if (m_output.resampler) {
+        const int dstWidth = dst.width(0);
+        for (int p = 0; p < 3; p++) {
+            m_resampleRing[p] = DoViScratchArena::take<float>(static_cast<size_t>(dstWidth) * m_output.resampler->verticalTaps());
+            if (converted) {
+                m_resampled[p] = DoViScratchArena::take<uint16_t>(dstWidth);
+            }
+        }
+        m_resampleSrc = DoViScratchArena::take<const float*>(m_output.resampler->verticalTaps());
+        m_resampleEnd = dst.height(0);
+    }
+    if (m_output.cube) {
+        m_cubeTmp = DoViScratchArena::take<uint8_t>(m_output.cubeTmpSize);
+        if (m_output.ditherThresholds) {
+            for (auto& r : m_cubeRows) {
+                r = DoViScratchArena::take<uint16_t>(dst.width(0));
+            }
+        }
+    }
+
+    m_measureRight = dst.width(0);
+    m_measureBottom = dst.height(0);
+    if (m_output.stats && m_output.activeRight) {
+        // the output columns and rows covered by the active area, rounded inwards
+        auto scale = [](int pos, int from, int to, bool up) {
+            const int64_t scaled = static_cast<int64_t>(std::clamp(pos, 0, from)) * to;
+            return static_cast<int>(up ? (scaled + from - 1) / from : scaled / from);
+        };
+        m_measureLeft = scale(m_output.activeLeft - m_output.cropLeft, m_cropWidth, m_measureRight, true);
+        m_measureRight = scale(m_output.activeRight - m_output.cropLeft, m_cropWidth, m_measureRight, false);
+        m_measureTop = scale(m_output.activeTop - m_output.cropTop, m_cropHeight, m_measureBottom, true);
+        m_measureBottom = scale(m_output.activeBottom - m_output.cropTop, m_cropHeight, m_measureBottom, false);
+    }
+    if (m_output.stats && m_output.measureLut) {
+        for (auto& r : m_measureRows) {
+            r = DoViScratchArena::take<uint16_t>(dst.width(0));
+        }
+    }
+}
+
+DoViRgbRows::~DoViRgbRows()
+{
+    if (m_output.stats) {
+        std::lock_guard<std::mutex> lock(m_output.stats->mutex);
+        m_output.stats->rgb.merge(m_stats);
+    }
+}
+
+uint16_t* DoViRgbRows::row(int plane, int y)
+{
+    if (m_rows[plane])
+        return m_rows[plane];
+    return reinterpret_cast<uint16_t*>(m_dst.write_ptr(plane) + y * m_dst.stride(plane));
+}
+
+void DoViRgbRows::resampleRows(int rowBegin, int rowEnd)
+{
+    m_resampleNext = rowBegin;
+    m_resampleEnd = rowEnd;
+}
+
+void DoViRgbRows::finish(int y)
+{
+    const int dstY = y - m_output.cropTop;
+    if (dstY < 0 || dstY >= m_cropHeight)
+        return;
+    if (m_output.activeRight) {
+        for (int p = 0; p < 3; p++) {
+            uint16_t* rowP = row(p, y);
+            std::fill(rowP, rowP + m_output.activeLeft, m_output.barFill);
+            std::fill(rowP + m_output.activeRight, rowP + m_width, m_output.barFill);
+        }
+    }
+    if (m_output.resampler) {
+        finishResampled(dstY);
+        return;
+    }
+
+    // only the columns of the output frame from here on
+    std::array<uint16_t*, 3> rows;
+    for (int p = 0; p < 3; p++) {
+        rows[p] = row(p, y) + m_output.cropLeft;
+    }
+    writeRow(rows, dstY, !m_rows[0]);
+}
+
+void DoViRgbRows::finishResampled(int srcY)
+{
+    const DoViResampler& resampler = *m_output.resampler;
+    const int taps = resampler.verticalTaps();
+    const int dstWidth = m_dst.width(0);
+    for (int p = 0; p < 3; p++) {
+        resampler.resampleRow(m_resampleRing[p] + static_cast<size_t>(srcY % taps) * dstWidth, m_rows[p] + m_output.cropLeft);
+    }
+
+    // the output rows whose source rows are complete now
+    for (; m_resampleNext < m_resampleEnd && resampler.lastRow(m_resampleNext) <= srcY; m_resampleNext++) {
+        const int firstRow = resampler.firstRow(m_resampleNext);
+        std::array<uint16_t*, 3> rows;
+        for (int p = 0; p < 3; p++) {
+            for (int i = 0; i < taps; i++) {
+                m_resampleSrc[i] = m_resampleRing[p] + static_cast<size_t>((firstRow + i) % taps) * dstWidth;
+            }
+            rows[p] = m_resampled[p] ? m_resampled[p]
+                                     : reinterpret_cast<uint16_t*>(m_dst.write_ptr(p) + m_resampleNext * m_dst.stride(p));
+            resampler.resampleColumn(rows[p], m_resampleSrc, m_resampleNext);
+        }
+        writeRow(rows, m_resampleNext, !m_resampled[0]);
+    }
+}
+
+void DoViRgbRows::writeRow(const std::array<uint16_t*, 3>& rows, int dstY, bool inPlace)
+{
+    const int width = m_dst.width(0);
+    if (m_output.stats && dstY >= m_measureTop && dstY < m_measureBottom && m_measureLeft < m_measureRight) {
+        const int measureWidth = m_measureRight - m_measureLeft;
+        std::array<const uint16_t*, 3> measured;
+        for (int p = 0; p < 3; p++) {
+            measured[p] = rows[p] + m_measureLeft;
+            if (m_output.measureLut) {
+                m_kernels.lookup16(m_measureRows[p], measured[p], measureWidth, m_output.measureLut);
+                measured[p] = m_measureRows[p];
+            }
+        }
+        m_kernels.maxRgbStats(m_stats, measured[0], measured[1], measured[2], measureWidth);
+    }
+    if (m_output.eetfLut) {
+        for (int p = 0; p < 3; p++) {
+            m_kernels.lookup16(rows[p], rows[p], width, m_output.eetfLut);
+        }
+    }
+    if (inPlace)
+        return;
+    const bool dither = m_output.ditherThresholds != nullptr;
+    if (m_output.cube) {
+        // the cube filter is made for single rows
+        const void* src[3];
+        void* dst[3];
+        ptrdiff_t srcStride[3];
+        ptrdiff_t dstStride[3];
+        for (int p = 0; p < 3; p++) {
+            src[p] = rows[p];
+            srcStride[p] = width * sizeof(uint16_t);
+            dst[p] = dither ? static_cast<void*>(m_cubeRows[p]) : m_dst.write_ptr(p) + dstY * m_dst.stride(p);
+            dstStride[p] = dither ? width * sizeof(uint16_t) : m_dst.stride(p);
+        }
+        timecube_filter_apply(m_output.cube, src, srcStride, dst, dstStride, m_cubeTmp);
+        if (!dither)
+            return;
+    }
+    for (int p = 0; p < 3; p++) {
+        uint8_t* dstP = m_dst.write_ptr(p) + dstY * m_dst.stride(p);
+        if (dither) {
+            const uint16_t* src = m_output.cube ? m_cubeRows[p] : rows[p];
+            const uint16_t* thresholds = m_output.ditherThresholds + DoViDither::size * (dstY % DoViDither::size);
+            const int shift = 16 - m_output.outDepth;
+            const int outMax = (1 << m_output.outDepth) - 1;
+            if (m_output.outDepth == 8) {
+                m_kernels.dither8(dstP, src, width, thresholds, shift, outMax);
+            } else {
+                m_kernels.dither16(reinterpret_cast<uint16_t*>(dstP), src, width, thresholds, shift, outMax);
+            }
+        } else if (m_output.floatLut) {
+            m_kernels.lookupFloat(reinterpret_cast<float*>(dstP), rows[p], width, m_output.floatLut);
+        } else if (m_output.halfLut) {
+            m_kernels.lookup16(reinterpret_cast<uint16_t*>(dstP), rows[p], width, m_output.halfLut);
+        } else {
+            std::copy_n(rows[p], width, reinterpret_cast<uint16_t*>(dstP));
+        }
+    }
+}
+
+void DoViRgbRows::finishBarRows(int rowBegin, int rowEnd)
+{
+    if (!m_output.activeRight)
+        return;
+    for (int y = rowBegin; y < rowEnd; y++) {
+        if (y >= m_output.activeTop && y < m_output.activeBottom)
+            continue;
+        const int dstY = y - m_output.cropTop;
+        if (dstY < 0 || dstY >= m_cropHeight)
+            continue;
+        for (int p = 0; p < 3; p++) {
+            uint16_t* rowP = row(p, y);
+            std::fill(rowP + m_output.cropLeft, rowP + m_output.cropLeft + m_cropWidth, m_output.barFill);
+        }
+        finish(y);
+    }
+}
+
+DoViStripEngine::DoViStripEngine(const ConstFrame& blSrc, const ConstFrame& elSrc, bool blChromaSubsampling, bool elChromaSubsampling,
+                                 bool quarterResolutionEl, const DoViProcessor& proc, DoViUpsampler upsampler)
+    : DoViStripEngine(blSrc, elSrc, blChromaSubsampling, elChromaSubsampling, quarterResolutionEl, proc, 0, blSrc.width(0), false, upsampler)
+{
+}
+
+DoViStripEngine::DoViStripEngine(const ConstFrame& blSrc, const ConstFrame& elSrc, bool blChromaSubsampling, bool elChromaSubsampling,
+                                 bool quarterResolutionEl, const DoViProcessor& proc, int viewLeft, int viewRight, bool halfResolution,
+                                 DoViUpsampler upsampler)
+    : m_proc(proc)
+    , m_kernels(DoViKernels::get())
+    , m_chromaSubsampling(!halfResolution && blChromaSubsampling && elChromaSubsampling)
+    , m_viewLeft(viewLeft)
+    , m_bl(blSrc, viewLeft, viewRight)
+    , m_el(elSrc, quarterResolutionEl ? viewLeft >> 1 : viewLeft,
+           viewRight >= blSrc.width(0) ? elSrc.width(0) : (quarterResolutionEl ? viewRight >> 1 : viewRight))
+{
+    DoViRowSource* bl = &m_bl;
+    DoViRowSource* el = &m_el;
+    if (halfResolution) {
+        m_blHalf = std::make_unique<DoViHalfResRows>(m_bl);
+        if (!quarterResolutionEl) {
+            m_elHalf = std::make_unique<DoViHalfResRows>(m_el);
+            el = m_elHalf.get();
+        } else if (elChromaSubsampling) {
+            m_el444 = std::make_unique<DoViChroma444Rows>(m_el, upsampler);
+            el = m_el444.get();
+        }
+        m_composed = std::make_unique<DoViComposedRows>(*m_blHalf, *el, false, proc);
+        m_yuv = m_composed.get();
+        return;
+    }
+    if (quarterResolutionEl) {
+        m_elUpscaled = std::make_unique<DoViUpscaled2xRows>(m_el, true, upsampler);
+        el = m_elUpscaled.get();
+    }
+    if (blChromaSubsampling != elChromaSubsampling) {
+        if (blChromaSubsampling) {
+            m_bl444 = std::make_unique<DoViChroma444Rows>(*bl, upsampler);
+            bl = m_bl444.get();
+        } else {
+            m_el444 = std::make_unique<DoViChroma444Rows>(*el, upsampler);
+            el = m_el444.get();
+        }
+    }
+    m_composed = std::make_unique<DoViComposedRows>(*bl, *el, m_chromaSubsampling, proc);
+    m_yuv = m_composed.get();
+    if (m_chromaSubsampling) {
+        m_chroma444 = std::make_unique<DoViUpscaled2xRows>(*m_yuv, false, upsampler);
+    }
+}
+
+DoViStripEngine::DoViStripEngine(const ConstFrame& composed, const DoViProcessor& proc, DoViUpsampler upsampler)
+    : m_proc(proc)
+    , m_kernels(DoViKernels::get())
+    , m_chromaSubsampling(composed.format().subSamplingW != 0)
+    , m_viewLeft(0)
+    , m_bl(composed)
+    , m_el(composed)
+{
+    m_yuv = &m_bl;
+    if (m_chromaSubsampling) {
+        m_chroma444 = std::make_unique<DoViUpscaled2xRows>(*m_yuv, false, upsampler);
+    }
+}
+
+void DoViStripEngine::renderRgb(DoViRgbRows& dst, int rowBegin, int rowEnd, bool applyTrim)
+{
+    const int width = m_yuv->width(0);
+    DoViRowSource& chroma = m_chroma444 ? static_cast<DoViRowSource&>(*m_chroma444) : *m_yuv;
+    const int16_t* coef = m_proc.getYccToRgbCoef();
+    const uint32_t* offset = m_proc.getYccToRgbOffset();
+    const bool ipt = m_proc.isIptInput();
+
+    for (int h = rowBegin; h < rowEnd; h++) {
+        const uint16_t* srcY = m_yuv->row(0, h);
+        const uint16_t* srcU = chroma.row(1, h);
+        const uint16_t* srcV = chroma.row(2, h);
+        uint16_t* dstR = dst.row(0, h) + m_viewLeft;
+        uint16_t* dstG = dst.row(1, h) + m_viewLeft;
+        uint16_t* dstB = dst.row(2, h) + m_viewLeft;
+        m_kernels.ycc2rgb(dstR, dstG, dstB, srcY, srcU, srcV, width, coef, offset);
+        if (ipt) {
+            m_proc.processLmsRow(dstR, dstG, dstB, width);
+        }
+        // trim the row while it is still in cache
+        if (applyTrim) {
+            m_proc.processTrimRow(dstR, dstG, dstB, width);
+        }
+        dst.finish(h);
+    }
+}
+
+void DoViStripEngine::renderYuv(Frame& dst, int rowBegin, int rowEnd)
+{
+    for (int p = 0; p < 3; p++) {
+        const int shift = (p && m_chromaSubsampling) ? 1 : 0;
+        const int width = dst.width(p);
+        const ptrdiff_t dstPitch = dst.stride(p) / sizeof(uint16_t);
+        uint16_t* dstP = reinterpret_cast<uint16_t*>(dst.write_ptr(p));
+        const int end = (rowEnd + shift) >> shift;
+        for (int h = rowBegin >> shift; h < end; h++) {
+            std::copy_n(m_yuv->row(p, h), width, dstP + h * dstPitch);
+        }
+    }
+}
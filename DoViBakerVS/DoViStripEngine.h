@@ -0,0 +1,260 @@
+#pragma once
+#include "VapourSynth4++.hpp"
+#include "DoViProcessor.h"
+#include "DoViKernels.h"
+#include "DoViResampler.h"
+#include "DoViScratchArena.h"
+#include "timecube.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace vsxx4;
+
+// Row based building blocks of the fused full quality pipeline.
+// Every stage hands out single rows on demand and only keeps the few rows its
+// consumers still need, so composing, chroma upsampling, RGB conversion and
+// trimming run back to back on cache resident data without intermediate frames.
+// The row buffers come from the DoViScratchArena, the stages must not outlive the enclosing Scope.
+
+// Filter of the 2x upsampling of chroma and of a quarter resolution EL. spline16 is the full quality default,
+// bilinear and nearest trade sharpness for speed; nearest skips the vertical pass altogether.
+enum class DoViUpsampler { nearest, bilinear, spline16 };
+
+class DoViRowSource {
+public:
+    virtual ~DoViRowSource() = default;
+
+    // Returned rows stay valid until a few rows further down have been requested
+    virtual const uint16_t* row(int plane, int y) = 0;
+
+    int width(int plane) const { return m_width[plane]; }
+    int height(int plane) const { return m_height[plane]; }
+
+protected:
+    std::array<int, 3> m_width{};
+    std::array<int, 3> m_height{};
+};
+
+// Small cache of the most recently produced rows of one plane, indexed by row number
+class DoViRowRing {
+public:
+    static constexpr int slots = 8;
+
+    void reset(int width);
+    const uint16_t* find(int y) const { return m_rowIdx[y & (slots - 1)] == y ? m_rows[y & (slots - 1)] : nullptr; }
+    uint16_t* claim(int y);
+
+private:
+    std::array<uint16_t*, slots> m_rows{};
+    std::array<int, slots> m_rowIdx{};
+};
+
+// Rows read straight from the planes of a frame, optionally only the columns [left, right) in luma samples.
+// left and right have to be multiples of the chroma subsampling, unless right is the frame width.
+class DoViFrameRows : public DoViRowSource {
+public:
+    explicit DoViFrameRows(const ConstFrame& frame);
+    DoViFrameRows(const ConstFrame& frame, int left, int right);
+    const uint16_t* row(int plane, int y) override { return m_ptr[plane] + y * m_pitch[plane]; }
+
+private:
+    std::array<const uint16_t*, 3> m_ptr{};
+    std::array<ptrdiff_t, 3> m_pitch{};
+};
+
+// BL and EL composed by the DoViProcessor, at the chroma resolution of the BL
+class DoViComposedRows : public DoViRowSource {
+public:
+    DoViComposedRows(DoViRowSource& bl, DoViRowSource& el, bool chromaSubsampling, const DoViProcessor& proc);
+    const uint16_t* row(int plane, int y) override;
+
+private:
+    void composeChroma(int y);
+
+    DoViRowSource& m_bl;
+    DoViRowSource& m_el;
+    const DoViProcessor& m_proc;
+    const bool m_chromaSubsampling;
+    std::array<DoViRowRing, 3> m_rings;
+    uint16_t* m_mmrRow = nullptr;
+};
+
+// 2x upscaling in both directions, vertical pass first, using the luma taps on
+// plane 0 and the chroma taps on planes 1 and 2 of the upsampler. Edges are clamped.
+class DoViUpscaled2xRows : public DoViRowSource {
+public:
+    DoViUpscaled2xRows(DoViRowSource& src, bool withLuma, DoViUpsampler upsampler = DoViUpsampler::spline16);
+    const uint16_t* row(int plane, int y) override;
+
+private:
+    using VertKernel = void (*)(uint16_t*, const uint16_t* const*, int, bool);
+    using HorzKernel = void (*)(uint16_t*, const uint16_t*, int);
+
+    DoViRowSource& m_src;
+    // luma and chroma kernels, no vertical ones for nearest
+    std::array<VertKernel, 2> m_vert{};
+    std::array<HorzKernel, 2> m_horz{};
+    uint16_t* m_vertRow = nullptr;
+    std::array<DoViRowRing, 3> m_rings;
+};
+
+// 4:4:4 view of a chroma subsampled source. Luma rows are handed out straight
+// from the source, only the chroma planes are upsampled.
+class DoViChroma444Rows : public DoViRowSource {
+public:
+    explicit DoViChroma444Rows(DoViRowSource& src, DoViUpsampler upsampler = DoViUpsampler::spline16);
+    const uint16_t* row(int plane, int y) override { return plane ? m_chroma.row(plane, y) : m_src.row(0, y); }
+
+private:
+    DoViRowSource& m_src;
+    DoViUpscaled2xRows m_chroma;
+};
+
+// Half resolution 4:4:4 view of a source. Luma, and chroma that is not subsampled, is filtered down to
+// the top left chroma positions like the MMR luma input; subsampled chroma is handed out as it is.
+class DoViHalfResRows : public DoViRowSource {
+public:
+    explicit DoViHalfResRows(DoViRowSource& src);
+    const uint16_t* row(int plane, int y) override;
+
+private:
+    DoViRowSource& m_src;
+    const bool m_chromaSubsampling;
+    std::array<DoViRowRing, 3> m_rings;
+};
+
+// max(R, G, B) statistics of a whole output frame, every DoViRgbRows adds the rows it measured when it is done
+struct DoViFrameStats {
+    std::mutex mutex;
+    DoViRgbStats rgb;
+};
+
+// Conversions of the finished 16 bit RGB rows, in this order, nullptr for the unused ones.
+// The resampler brings the cropped rows to the output size, its source size being that of the crop.
+// floatLut is for 32 bit float, halfLut for half float output, neither for 16 bit integer.
+// The cube writes 16 bit integer output itself and excludes the float tables.
+// The 16 bit tables have one padding entry.
+// Integer output below 16 bits is dithered down to outDepth bits as the last step, output row y using
+// the 64 thresholds at ditherThresholds + 64 * (y % 64).
+struct DoViRgbOutput {
+    const DoViResampler* resampler = nullptr;
+    const uint16_t* eetfLut = nullptr;
+    const timecube_filter* cube = nullptr;
+    size_t cubeTmpSize = 0;
+    const float* floatLut = nullptr;
+    const uint16_t* halfLut = nullptr;
+    const uint16_t* ditherThresholds = nullptr;
+    int outDepth = 16;
+
+    // Everything outside the active area [activeLeft, activeRight) x [activeTop, activeBottom)
+    // is set to barFill before the conversions, no bars if activeRight is 0
+    int activeLeft = 0;
+    int activeRight = 0;
+    int activeTop = 0;
+    int activeBottom = 0;
+    uint16_t barFill = 0;
+    // position of the output frame within the rendered rows, if it is cropped
+    int cropLeft = 0;
+    int cropTop = 0;
+    // measures the output rows within the active area before the EETF, if set; limited range rows
+    // are expanded to full range through measureLut first
+    DoViFrameStats* stats = nullptr;
+    const uint16_t* measureLut = nullptr;
+};
+
+// Destination rows of the RGB output, addressed in rendered coordinates of the given size.
+// 16 bit integer frames are rendered into in place, float and half float frames get every finished
+// 16 bit row converted through a table of all codes. An EETF is applied to the finished rows before
+// the conversion, a cube reads them from a scratch row. Rows of a lower output depth are dithered into
+// the frame from the scratch rows, or from further scratch rows written by the cube. Cropped frames also render into scratch rows.
+// With a resampler the rows are rendered into scratch rows, resampled horizontally into a ring of the
+// last few source rows, and every output row is resampled vertically as soon as its last source row is done.
+class DoViRgbRows {
+public:
+    DoViRgbRows(Frame& dst, int width, int height, const DoViRgbOutput& output);
+    ~DoViRgbRows();
+
+    uint16_t* row(int plane, int y);
+    // to be called once the row y of all planes is complete
+    void finish(int y);
+    // fills and finishes the rows of [rowBegin, rowEnd) above and below the active area
+    void finishBarRows(int rowBegin, int rowEnd);
+    // with a resampler, produces the output rows [rowBegin, rowEnd) only; the rendered rows from
+    // firstRow(rowBegin) to lastRow(rowEnd - 1) of the resampler, offset by cropTop, have to be finished in order
+    void resampleRows(int rowBegin, int rowEnd);
+
+private:
+    void finishResampled(int srcY);
+    // applies the EETF to the output row dstY and writes it to the frame, unless it was rendered there
+    void writeRow(const std::array<uint16_t*, 3>& rows, int dstY, bool inPlace);
+
+    Frame& m_dst;
+    const DoViKernels& m_kernels;
+    const DoViRgbOutput m_output;
+    const int m_width;
+    // size of the cropped rows, the source size of the resampler
+    int m_cropWidth;
+    int m_cropHeight;
+    std::array<uint16_t*, 3> m_rows{};
+    void* m_cubeTmp = nullptr;
+    std::array<uint16_t*, 3> m_cubeRows{};
+
+    std::array<float*, 3> m_resampleRing{};
+    std::array<uint16_t*, 3> m_resampled{};
+    const float** m_resampleSrc = nullptr;
+    int m_resampleNext = 0;
+    int m_resampleEnd = 0;
+
+    // the measured part of the output frame, the active area scaled to the output size
+    DoViRgbStats m_stats;
+    std::array<uint16_t*, 3> m_measureRows{};
+    int m_measureLeft = 0;
+    int m_measureRight = 0;
+    int m_measureTop = 0;
+    int m_measureBottom = 0;
+};
+
+// Renders the output of a frame row by row. A quarter resolution EL is
+// upscaled on the fly, only the few rows the composition needs exist at a time.
+// If BL and EL chroma subsampling differ, the subsampled one is brought to 4:4:4 first.
+// RGB output can be limited to the columns [viewLeft, viewRight) in BL luma samples, which have
+// to be multiples of 4 unless viewRight is the frame width. The filters clamp at the view edges,
+// so the columns within the reach of the filter taps from there differ from a full width render.
+// With halfResolution the RGB output is composed on a 2x decimated grid for previews: the BL is
+// brought to half resolution 4:4:4 by DoViHalfResRows, a quarter resolution EL is used as it is
+// and the view has to be the whole frame.
+// An engine can also render from a frame composed before by renderYuv, which it only upsamples and converts.
+// The upsampler is used for the EL and for all chroma upsampling.
+class DoViStripEngine {
+public:
+    DoViStripEngine(const ConstFrame& blSrc, const ConstFrame& elSrc, bool blChromaSubsampling, bool elChromaSubsampling,
+                    bool quarterResolutionEl, const DoViProcessor& proc, DoViUpsampler upsampler = DoViUpsampler::spline16);
+    DoViStripEngine(const ConstFrame& blSrc, const ConstFrame& elSrc, bool blChromaSubsampling, bool elChromaSubsampling,
+                    bool quarterResolutionEl, const DoViProcessor& proc, int viewLeft, int viewRight, bool halfResolution = false,
+                    DoViUpsampler upsampler = DoViUpsampler::spline16);
+    DoViStripEngine(const ConstFrame& composed, const DoViProcessor& proc, DoViUpsampler upsampler = DoViUpsampler::spline16);
+
+    void renderRgb(DoViRgbRows& dst, int rowBegin, int rowEnd, bool applyTrim);
+    // Writes the composition, subsampled if BL and EL both are and 4:4:4 otherwise; rowBegin must be even if subsampled
+    void renderYuv(Frame& dst, int rowBegin, int rowEnd);
+
+private:
+    const DoViProcessor& m_proc;
+    const DoViKernels& m_kernels;
+    const bool m_chromaSubsampling;
+    const int m_viewLeft;
+    DoViFrameRows m_bl;
+    DoViFrameRows m_el;
+    std::unique_ptr<DoViUpscaled2xRows> m_elUpscaled;
+    std::unique_ptr<DoViChroma444Rows> m_bl444;
+    std::unique_ptr<DoViChroma444Rows> m_el444;
+    std::unique_ptr<DoViHalfResRows> m_blHalf;
+    std::unique_ptr<DoViHalfResRows> m_elHalf;
+    std::unique_ptr<DoViComposedRows> m_composed;
+    // the composed rows, or the rows of the composed frame
+    DoViRowSource* m_yuv = nullptr;
+    std::unique_ptr<DoViUpscaled2xRows> m_chroma444;
+};
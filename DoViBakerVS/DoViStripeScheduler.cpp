@@ -0,0 +1,98 @@
+#include "DoViStripeScheduler.h"
+#include <algorithm>
+
+DoViStripeScheduler::DoViStripeScheduler(int threads)
+{
+    for (int i = 1; i < threads; i++) {
+        m_workers.emplace_back(&DoViStripeScheduler::workerLoop, this);
+    }
+}
+
+DoViStripeScheduler::~DoViStripeScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_workCV.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void DoViStripeScheduler::parallelFor(int count, int align, int minRows, const std::function<void(int, int)>& fn)
+{
+    // a few stripes per thread so that stripes finishing at different speeds even out
+    int stripeRows = std::max((count + 2 * threads() - 1) / (2 * threads()), minRows);
+    stripeRows = (stripeRows + align - 1) / align * align;
+    if (m_workers.empty() || stripeRows >= count) {
+        fn(0, count);
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->fn = &fn;
+    job->count = count;
+    job->stripeRows = stripeRows;
+    job->numStripes = (count + stripeRows - 1) / stripeRows;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(job);
+    }
+    m_workCV.notify_all();
+
+    while (runStripe(*job)) {}
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCV.wait(lock, [&] { return job->done.load() == job->numStripes; });
+    if (job->error) {
+        std::rethrow_exception(job->error);
+    }
+}
+
+bool DoViStripeScheduler::runStripe(Job& job)
+{
+    const int stripe = job.next.fetch_add(1);
+    if (stripe >= job.numStripes)
+        return false;
+
+    const int begin = stripe * job.stripeRows;
+    // a throwing stripe must not unwind a worker or leave the job half done, it still counts as done
+    if (!job.failed.load()) {
+        try {
+            (*job.fn)(begin, std::min(begin + job.stripeRows, job.count));
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!job.error) {
+                job.error = std::current_exception();
+            }
+            job.failed = true;
+        }
+    }
+
+    if (job.done.fetch_add(1) + 1 == job.numStripes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_doneCV.notify_all();
+    }
+    return true;
+}
+
+void DoViStripeScheduler::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_workCV.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+        if (m_stop)
+            return;
+
+        std::shared_ptr<Job> job = m_jobs.front();
+        if (job->next.load() >= job->numStripes) {
+            // all stripes handed out, the owner waits for the remaining ones
+            m_jobs.pop_front();
+            continue;
+        }
+        lock.unlock();
+        runStripe(*job);
+        lock.lock();
+    }
+}
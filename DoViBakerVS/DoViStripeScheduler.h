@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Splits the rows of a frame into horizontal stripes and processes them on a small
+// pool of worker threads. The calling thread works on its own frame too, and idle
+// workers pick up stripes of whichever frame still has some left, so a single frame
+// can use all cores while several frames in flight do not oversubscribe them.
+class DoViStripeScheduler {
+public:
+    explicit DoViStripeScheduler(int threads);
+    ~DoViStripeScheduler();
+
+    int threads() const { return static_cast<int>(m_workers.size()) + 1; }
+
+    // Calls fn(begin, end) for consecutive stripes covering [0, count) and returns when all are done.
+    // Stripe boundaries are multiples of align and stripes are at least minRows long.
+    // The first exception thrown by a stripe is rethrown once all stripes are done.
+    void parallelFor(int count, int align, int minRows, const std::function<void(int, int)>& fn);
+
+private:
+    struct Job {
+        const std::function<void(int, int)>* fn;
+        int count;
+        int stripeRows;
+        int numStripes;
+        std::atomic<int> next{ 0 };
+        std::atomic<int> done{ 0 };
+        // first exception of a stripe, set under m_mutex; later stripes are skipped
+        std::exception_ptr error;
+        std::atomic<bool> failed{ false };
+    };
+
+    bool runStripe(Job& job);
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::shared_ptr<Job>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_workCV;
+    std::condition_variable m_doneCV;
+    bool m_stop = false;
+};
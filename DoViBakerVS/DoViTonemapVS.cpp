@@ -1,5 +1,8 @@
 #include "DoViTonemapVS.h"
 #include "DoViProcessor.h"
+#include "DoViDither.h"
+#include "DoViKernels.h"
+#include "DoViScratchArena.h"
 #include "VSHelper4.h"
 #include <stdexcept>
 #include <cmath>
@@ -7,12 +10,12 @@
 DoViTonemapVS::DoViTonemapVS(void*)
     : m_vi{}
     , m_bitDepth(0)
+    , m_outDepth(0)
     , m_targetMaxPq(0)
     , m_targetMinPq(0)
     , m_masterMaxPq(0)
     , m_masterMinPq(0)
     , m_lumScale(1.0f)
-    , m_limitedInput(false)
     , m_dynamicMasterMaxPq(false)
     , m_dynamicMasterMinPq(false)
     , m_dynamicLumScale(false)
@@ -36,6 +39,16 @@ void DoViTonemapVS::init(const ConstMap& in, const Map& out, const Core& core)
     if (m_bitDepth != 10 && m_bitDepth != 12 && m_bitDepth != 14 && m_bitDepth != 16)
         throw std::runtime_error("DoViTonemap: bit depth must be 10, 12, 14, or 16");
 
+    m_outDepth = static_cast<int>(in.get_prop<int64_t>("outDepth", map::default_val(static_cast<int64_t>(m_bitDepth))));
+    const int dither = static_cast<int>(in.get_prop<int64_t>("dither", map::default_val(static_cast<int64_t>(DoViDither::blueNoise))));
+    if (m_outDepth != m_bitDepth) {
+        if ((m_outDepth != 8 && m_outDepth != 10 && m_outDepth != 12) || m_outDepth > m_bitDepth)
+            throw std::runtime_error("DoViTonemap: outDepth must be 8, 10 or 12 and not above the input bit depth");
+        if (dither < DoViDither::none || dither > DoViDither::blueNoise)
+            throw std::runtime_error("DoViTonemap: dither must be 0 (none), 1 (ordered) or 2 (blue noise)");
+        m_ditherThresholds = DoViDither::thresholds(static_cast<DoViDither::Type>(dither), m_bitDepth - m_outDepth);
+    }
+
     // Get parameters with defaults
     float targetMaxNits = static_cast<float>(in.get_prop<double>("targetMaxNits", map::default_val(1000.0)));
     float targetMinNits = static_cast<float>(in.get_prop<double>("targetMinNits", map::default_val(0.0)));
@@ -50,7 +63,6 @@ void DoViTonemapVS::init(const ConstMap& in, const Map& out, const Core& core)
     m_masterMaxPq = DoViProcessor::nits2pq(masterMaxNits < 0 ? 10000.0f : masterMaxNits);
     m_masterMinPq = DoViProcessor::nits2pq(masterMinNits < 0 ? 0.0f : masterMinNits);
     m_lumScale = lumScale < 0 ? 1.0f : lumScale;
-    m_limitedInput = false;
 
     m_dynamicMasterMaxPq = masterMaxNits < 0;
     m_dynamicMasterMinPq = masterMinNits < 0;
@@ -63,26 +75,23 @@ void DoViTonemapVS::init(const ConstMap& in, const Map& out, const Core& core)
         throw std::runtime_error("DoViTonemap: master capabilities given are invalid");
     }
 
-    // Create appropriate EETF instance based on bit depth
+    // Create the EETF cache of the bit depth
     switch (m_bitDepth) {
         case 10:
-            m_eetf10 = std::make_unique<DoViEetf<10>>(m_kneeOffset, m_normalizeOutput);
-            m_eetf10->generateEETF(m_targetMaxPq, m_targetMinPq, m_masterMaxPq, m_masterMinPq, m_lumScale, m_limitedInput);
+            m_eetf10 = std::make_unique<DoViEetfCache<10>>(m_targetMaxPq, m_targetMinPq, m_kneeOffset, m_normalizeOutput);
             break;
         case 12:
-            m_eetf12 = std::make_unique<DoViEetf<12>>(m_kneeOffset, m_normalizeOutput);
-            m_eetf12->generateEETF(m_targetMaxPq, m_targetMinPq, m_masterMaxPq, m_masterMinPq, m_lumScale, m_limitedInput);
+            m_eetf12 = std::make_unique<DoViEetfCache<12>>(m_targetMaxPq, m_targetMinPq, m_kneeOffset, m_normalizeOutput);
             break;
         case 14:
-            m_eetf14 = std::make_unique<DoViEetf<14>>(m_kneeOffset, m_normalizeOutput);
-            m_eetf14->generateEETF(m_targetMaxPq, m_targetMinPq, m_masterMaxPq, m_masterMinPq, m_lumScale, m_limitedInput);
+            m_eetf14 = std::make_unique<DoViEetfCache<14>>(m_targetMaxPq, m_targetMinPq, m_kneeOffset, m_normalizeOutput);
             break;
         case 16:
-            m_eetf16 = std::make_unique<DoViEetf<16>>(m_kneeOffset, m_normalizeOutput);
-            m_eetf16->generateEETF(m_targetMaxPq, m_targetMinPq, m_masterMaxPq, m_masterMinPq, m_lumScale, m_limitedInput);
+            m_eetf16 = std::make_unique<DoViEetfCache<16>>(m_targetMaxPq, m_targetMinPq, m_kneeOffset, m_normalizeOutput);
             break;
     }
 
+    m_vi.format = core.query_video_format(cfRGB, stInteger, m_outDepth, 0, 0);
     create_video_filter(out, m_vi, fmParallel, simple_dep(m_clip, rpStrictSpatial), core);
 }
 
@@ -100,7 +109,7 @@ ConstFrame DoViTonemapVS::get_frame(int n, const Core& core, const FrameContext&
     uint16_t maxPq = m_masterMaxPq;
     uint16_t minPq = m_masterMinPq;
     float scale = m_lumScale;
-    bool limited = m_limitedInput;
+    bool limited = false;
 
     // Check for _ColorRange property
     if (src.frame_props_ro().contains("_ColorRange")) {
@@ -135,52 +144,47 @@ ConstFrame DoViTonemapVS::get_frame(int n, const Core& core, const FrameContext&
         }
     }
 
-    // Regenerate EETF if parameters changed
-    if (maxPq != m_masterMaxPq || minPq != m_masterMinPq || std::abs(scale - m_lumScale) > 0.001f || limited != m_limitedInput) {
-        m_masterMaxPq = maxPq;
-        m_masterMinPq = minPq;
-        m_lumScale = scale;
-        m_limitedInput = limited;
-
-        switch (m_bitDepth) {
-            case 10:
-                m_eetf10->generateEETF(m_targetMaxPq, m_targetMinPq, m_masterMaxPq, m_masterMinPq, m_lumScale, m_limitedInput);
-                break;
-            case 12:
-                m_eetf12->generateEETF(m_targetMaxPq, m_targetMinPq, m_masterMaxPq, m_masterMinPq, m_lumScale, m_limitedInput);
-                break;
-            case 14:
-                m_eetf14->generateEETF(m_targetMaxPq, m_targetMinPq, m_masterMaxPq, m_masterMinPq, m_lumScale, m_limitedInput);
-                break;
-            case 16:
-                m_eetf16->generateEETF(m_targetMaxPq, m_targetMinPq, m_masterMaxPq, m_masterMinPq, m_lumScale, m_limitedInput);
-                break;
-        }
-    }
-
-    // Apply tonemap based on bit depth
+    // The curve of the frame, shared with the other frames of its scene. The reference keeps
+    // it alive while the frame is tonemapped, even if the cache drops it meanwhile.
     switch (m_bitDepth) {
-        case 10: applyTonemapRGB<10>(dst, src); break;
-        case 12: applyTonemapRGB<12>(dst, src); break;
-        case 14: applyTonemapRGB<14>(dst, src); break;
-        case 16: applyTonemapRGB<16>(dst, src); break;
+        case 10: applyTonemapRGB<10>(dst, src, *m_eetf10->get(maxPq, minPq, scale, limited)); break;
+        case 12: applyTonemapRGB<12>(dst, src, *m_eetf12->get(maxPq, minPq, scale, limited)); break;
+        case 14: applyTonemapRGB<14>(dst, src, *m_eetf14->get(maxPq, minPq, scale, limited)); break;
+        case 16: applyTonemapRGB<16>(dst, src, *m_eetf16->get(maxPq, minPq, scale, limited)); break;
     }
 
     return dst;
 }
 
 template<int signalBitDepth>
-void DoViTonemapVS::applyTonemapRGB(Frame& dst, const ConstFrame& src) const
+void DoViTonemapVS::applyTonemapRGB(Frame& dst, const ConstFrame& src, const DoViEetf<signalBitDepth>& eetf) const
 {
-    const DoViEetf<signalBitDepth>* eetf = nullptr;
-    if constexpr (signalBitDepth == 10) eetf = m_eetf10.get();
-    else if constexpr (signalBitDepth == 12) eetf = m_eetf12.get();
-    else if constexpr (signalBitDepth == 14) eetf = m_eetf14.get();
-    else if constexpr (signalBitDepth == 16) eetf = m_eetf16.get();
-
     const int height = src.height(0);
     const int width = m_vi.width;
 
+    if (!m_ditherThresholds.empty()) {
+        // the tonemapped rows are dithered down to the output depth on their way to the frame
+        const DoViKernels& kernels = DoViKernels::get();
+        const int shift = signalBitDepth - m_outDepth;
+        const int outMax = (1 << m_outDepth) - 1;
+        DoViScratchArena::Scope scratch;
+        uint16_t* row = DoViScratchArena::take<uint16_t>(width);
+        for (int p = 0; p < 3; ++p) {
+            for (int h = 0; h < height; ++h) {
+                const uint16_t* srcP = reinterpret_cast<const uint16_t*>(src.read_ptr(p) + h * src.stride(p));
+                uint8_t* dstP = dst.write_ptr(p) + h * dst.stride(p);
+                const uint16_t* thresholds = m_ditherThresholds.data() + DoViDither::size * (h % DoViDither::size);
+                kernels.lookup16(row, srcP, width, eetf.data());
+                if (m_outDepth == 8) {
+                    kernels.dither8(dstP, row, width, thresholds, shift, outMax);
+                } else {
+                    kernels.dither16(reinterpret_cast<uint16_t*>(dstP), row, width, thresholds, shift, outMax);
+                }
+            }
+        }
+        return;
+    }
+
     for (int p = 0; p < 3; ++p) {
         const uint16_t* srcP = reinterpret_cast<const uint16_t*>(src.read_ptr(p));
         uint16_t* dstP = reinterpret_cast<uint16_t*>(dst.write_ptr(p));
@@ -189,7 +193,7 @@ void DoViTonemapVS::applyTonemapRGB(Frame& dst, const ConstFrame& src) const
 
         for (int h = 0; h < height; ++h) {
             for (int w = 0; w < width; ++w) {
-                dstP[w] = eetf->applyEETF(srcP[w]);
+                dstP[w] = eetf.applyEETF(srcP[w]);
             }
             srcP += srcStride;
             dstP += dstStride;
@@ -198,7 +202,7 @@ void DoViTonemapVS::applyTonemapRGB(Frame& dst, const ConstFrame& src) const
 }
 
 // Explicit template instantiations
-template void DoViTonemapVS::applyTonemapRGB<10>(Frame& dst, const ConstFrame& src) const;
-template void DoViTonemapVS::applyTonemapRGB<12>(Frame& dst, const ConstFrame& src) const;
-template void DoViTonemapVS::applyTonemapRGB<14>(Frame& dst, const ConstFrame& src) const;
-template void DoViTonemapVS::applyTonemapRGB<16>(Frame& dst, const ConstFrame& src) const;
+template void DoViTonemapVS::applyTonemapRGB<10>(Frame& dst, const ConstFrame& src, const DoViEetf<10>& eetf) const;
+template void DoViTonemapVS::applyTonemapRGB<12>(Frame& dst, const ConstFrame& src, const DoViEetf<12>& eetf) const;
+template void DoViTonemapVS::applyTonemapRGB<14>(Frame& dst, const ConstFrame& src, const DoViEetf<14>& eetf) const;
+template void DoViTonemapVS::applyTonemapRGB<16>(Frame& dst, const ConstFrame& src, const DoViEetf<16>& eetf) const;
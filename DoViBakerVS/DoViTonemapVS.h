@@ -1,8 +1,9 @@
 #pragma once
 #include "VapourSynth4++.hpp"
-#include "DoViEetf.h"
+#include "DoViEetfCache.h"
 #include <memory>
 #include <cstdint>
+#include <vector>
 
 using namespace vsxx4;
 
@@ -18,28 +19,31 @@ public:
 
 private:
     template<int signalBitDepth>
-    void applyTonemapRGB(Frame& dst, const ConstFrame& src) const;
+    void applyTonemapRGB(Frame& dst, const ConstFrame& src, const DoViEetf<signalBitDepth>& eetf) const;
 
     FilterNode m_clip;
     VSVideoInfo m_vi;
     int m_bitDepth;
+    // Output of fewer bits than the input is dithered down with these thresholds
+    int m_outDepth;
+    std::vector<uint16_t> m_ditherThresholds;
 
     uint16_t m_targetMaxPq;
     uint16_t m_targetMinPq;
-    mutable uint16_t m_masterMaxPq;
-    mutable uint16_t m_masterMinPq;
-    mutable float m_lumScale;
-    mutable bool m_limitedInput;
+    // master range and luminosity scale of the frames unless taken from their properties
+    uint16_t m_masterMaxPq;
+    uint16_t m_masterMinPq;
+    float m_lumScale;
 
     bool m_dynamicMasterMaxPq;
     bool m_dynamicMasterMinPq;
     bool m_dynamicLumScale;
 
-    // EETF instances for different bit depths
-    mutable std::unique_ptr<DoViEetf<10>> m_eetf10;
-    mutable std::unique_ptr<DoViEetf<12>> m_eetf12;
-    mutable std::unique_ptr<DoViEetf<14>> m_eetf14;
-    mutable std::unique_ptr<DoViEetf<16>> m_eetf16;
+    // EETF curves of the frames, only the one of the input bit depth is created
+    std::unique_ptr<DoViEetfCache<10>> m_eetf10;
+    std::unique_ptr<DoViEetfCache<12>> m_eetf12;
+    std::unique_ptr<DoViEetfCache<14>> m_eetf14;
+    std::unique_ptr<DoViEetfCache<16>> m_eetf16;
 
     float m_kneeOffset;
     bool m_normalizeOutput;
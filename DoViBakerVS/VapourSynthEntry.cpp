@@ -3,6 +3,7 @@
 #include "DoViTonemapVS.h"
 #include "DoViCubesVS.h"
 #include "DoViStatsFileLoaderVS.h"
+#include "DoViAnalyzeRpuVS.h"
 
 const PluginInfo4 g_plugin_info4 = {
     "com.dovibaker.vs",
@@ -20,12 +21,70 @@ const PluginInfo4 g_plugin_info4 = {
             "targetMaxNits:float:opt;"
             "targetMinNits:float:opt;"
             "qnd:int:opt;"
+            "preview:int:opt;"
+            "upsampler:data:opt;"
             "rgbProof:int:opt;"
             "nlqProof:int:opt;"
             "outYUV:int:opt;"
-            "sourceProfile:int:opt;",
+            "outFloat:int:opt;"
+            "outLinear:int:opt;"
+            "outDepth:int:opt;"
+            "dither:int:opt;"
+            "tonemapMaxNits:float:opt;"
+            "tonemapMinNits:float:opt;"
+            "masterMaxNits:float:opt;"
+            "masterMinNits:float:opt;"
+            "lumScale:float:opt;"
+            "kneeOffset:float:opt;"
+            "normalizeOutput:int:opt;"
+            "cubes:data[]:opt;"
+            "mclls:int[]:opt;"
+            "cubes_basepath:data:opt;"
+            "cubesFullrange:int:opt;"
+            "activeArea:int:opt;"
+            "cropActiveArea:int:opt;"
+            "outWidth:int:opt;"
+            "outHeight:int:opt;"
+            "resizeKernel:data:opt;"
+            "measure:int:opt;"
+            "sourceProfile:int:opt;"
+            "rpuConvertMode:int:opt;"
+            "rpuRemoveMapping:int:opt;"
+            "rpuOut:data:opt;"
+            "cacheDir:data:opt;"
+            "threads:int:opt;",
             "clip:vnode;"
         },
+        {
+            &DoViBakerVS::createMulti,
+            "BakerMulti",
+            "bl:vnode;"
+            "el:vnode:opt;"
+            "rpu:data:opt;"
+            "trimPq:int[]:opt;"
+            "targetMaxNits:float[]:opt;"
+            "targetMinNits:float[]:opt;"
+            "rgbProof:int:opt;"
+            "nlqProof:int:opt;"
+            "upsampler:data:opt;"
+            "outYUV:int[]:opt;"
+            "outFloat:int[]:opt;"
+            "outLinear:int[]:opt;"
+            "outDepth:int[]:opt;"
+            "dither:int[]:opt;"
+            "tonemapMaxNits:float[]:opt;"
+            "tonemapMinNits:float[]:opt;"
+            "masterMaxNits:float[]:opt;"
+            "masterMinNits:float[]:opt;"
+            "lumScale:float[]:opt;"
+            "kneeOffset:float[]:opt;"
+            "normalizeOutput:int[]:opt;"
+            "measure:int[]:opt;"
+            "sourceProfile:int:opt;"
+            "cacheDir:data:opt;"
+            "threads:int:opt;",
+            "clip:vnode[];"
+        },
         {
             &FilterBase::filter_create<DoViTonemapVS>,
             "Tonemap",
@@ -36,7 +95,9 @@ const PluginInfo4 g_plugin_info4 = {
             "masterMinNits:float:opt;"
             "lumScale:float:opt;"
             "kneeOffset:float:opt;"
-            "normalizeOutput:int:opt;",
+            "normalizeOutput:int:opt;"
+            "outDepth:int:opt;"
+            "dither:int:opt;",
             "clip:vnode;"
         },
         {
@@ -56,6 +117,31 @@ const PluginInfo4 g_plugin_info4 = {
             "statsFile:data;"
             "sceneCutsFile:data:opt;",
             "clip:vnode;"
+        },
+        {
+            &DoViAnalyzeRpuVS::create,
+            "AnalyzeRpu",
+            "rpu:data;"
+            "threads:int:opt;",
+            "frames:int;"
+            "profile:int;"
+            "el_type:data;"
+            "residual_frames:int;"
+            "identity_mapping_frames:int;"
+            "poly_mapping_frames:int;"
+            "mmr_mapping_frames:int;"
+            "scenes:int;"
+            "scene_cuts:int[];"
+            "l1_min_pq:int[];"
+            "l1_max_pq:int[];"
+            "l1_avg_pq:int[];"
+            "l2_trim_pqs:int[];"
+            "l5_offsets:int[]:opt;"
+            "l5_varies:int:opt;"
+            "l6_max_cll:int[]:opt;"
+            "l6_max_fall:int[]:opt;"
+            "l6_master_display_max_luminance:int[]:opt;"
+            "l6_master_display_min_luminance:int[]:opt;"
         }
     }
 };
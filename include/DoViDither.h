@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Threshold matrices of the ordered dithering to lower bit depths, applied by the dither kernels.
+// A matrix has 64 x 64 entries and is tiled over the frame, row y of the frame uses the 64 thresholds
+// starting at 64 * (y % 64).
+//   none       rounds to the nearest code, every threshold is half a step
+//   ordered    Bayer matrix, a fine regular pattern
+//   blueNoise  void and cluster matrix, noise without low frequencies, the least visible pattern
+class DoViDither {
+public:
+  enum Type { none = 0, ordered = 1, blueNoise = 2 };
+  static constexpr int size = 64;
+
+  // thresholds in [0, 1 << shift) for dropping shift bits, the matrices are built on first use
+  static std::vector<uint16_t> thresholds(Type type, int shift);
+
+private:
+  // ranks 0 .. size * size - 1 of the matrix entries
+  static const uint16_t* bayerRanks();
+  static const uint16_t* blueNoiseRanks();
+};
@@ -8,6 +8,8 @@ public:
   DoViEetf(float kneeOffset, bool normalizeOutput);
 
   inline uint16_t applyEETF(uint16_t s) const { return lut[s]; };
+  // the whole LUT, padded by one entry for vectorized lookups
+  inline const uint16_t* data() const { return lut; }
   void generateEETF(
     uint16_t targetMaxPq,
     uint16_t targetMinPq,
@@ -22,7 +24,7 @@ private:
   static constexpr int LUT_SIZE = 1 << signalBitDepth;
   const float kneeOffset;
   const bool normalizeOutput;
-  uint16_t lut[LUT_SIZE];
+  uint16_t lut[LUT_SIZE + 1] = {};
 };
 
 template<int signalBitDepth>
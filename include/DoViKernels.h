@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+
+// Row kernels of the processing pipeline. Every kernel has a portable implementation and,
+// on x86, AVX2 and AVX-512 variants which are selected once at runtime.
+// All variants produce bit-identical results.
+
+// Per frame lookup tables of one component, prepared by the DoViProcessor
+struct DoViReshapeTables {
+  const int32_t* blMapping;  // mapped BL sample plus the reconstruction rounding, indexed by BL sample >> blShift
+  const int32_t* elResidual; // dequantized EL residual, indexed by EL sample >> elShift; nullptr without residual
+  int blShift;
+  int blMaxIndex;
+  int elShift;
+  int elMaxIndex;
+  int outShift; // 16 - output bit depth
+  int outMax;
+};
+
+// Per scene tables of the L2 trim, prepared by the DoViProcessor
+struct DoViTrimTables {
+  const float* tone;         // linear light after the tone curve and slope / offset / power, indexed by input sample >> inShift
+  const float* pqThresholds; // smallest linear light mapping to each of the 4096 12 bit PQ codes
+  int inShift;
+  int outShift;
+  float chromaWeight;   // 1 + cS[0]
+  float saturationGain; // cS[1]
+};
+
+// Per frame data of the LMS to RGB conversion of IPT input, prepared by the DoViProcessor
+struct DoViLmsTables {
+  const float* eotf;   // linear light of every 16 bit PQ LMS code
+  float lmsToRgb[9];   // linear LMS to linear RGB, row major
+};
+
+// Statistics of max(R, G, B) over the measured samples of 16 bit RGB rows
+struct DoViRgbStats {
+  uint64_t sum = 0;
+  uint64_t count = 0;
+  uint32_t min = 0xFFFF;
+  uint32_t max = 0;
+  uint32_t histogram[64] = {}; // bins of 1024 codes
+
+  void merge(const DoViRgbStats& other)
+  {
+    sum += other.sum;
+    count += other.count;
+    min = other.min < min ? other.min : min;
+    max = other.max > max ? other.max : max;
+    for (int i = 0; i < 64; i++)
+      histogram[i] += other.histogram[i];
+  }
+};
+
+struct DoViKernels {
+  // 2x vertical upsampling of one output row. src holds the 5 (luma) or 4 (chroma)
+  // source rows around the output row, already clamped at the frame edges.
+  void (*upsampleLumaVert)(uint16_t* dst, const uint16_t* const* src, int width, bool odd);
+  void (*upsampleChromaVert)(uint16_t* dst, const uint16_t* const* src, int width, bool odd);
+
+  // 2x horizontal upsampling of one row, dst receives 2 * width samples
+  void (*upsampleLumaHorz)(uint16_t* dst, const uint16_t* src, int width);
+  void (*upsampleChromaHorz)(uint16_t* dst, const uint16_t* src, int width);
+
+  // Bilinear variants of the 2x upsampling, at the sample positions of the taps above: luma at -1/4 and +1/4
+  // of a source sample, chroma at the source sample and halfway to the next one. Nearest neighbour upsampling
+  // needs no kernels of its own, it takes the source rows as they are and replicate2x.
+  void (*upsampleLumaVertBilinear)(uint16_t* dst, const uint16_t* const* src, int width, bool odd);
+  void (*upsampleChromaVertBilinear)(uint16_t* dst, const uint16_t* const* src, int width, bool odd);
+  void (*upsampleLumaHorzBilinear)(uint16_t* dst, const uint16_t* src, int width);
+  void (*upsampleChromaHorzBilinear)(uint16_t* dst, const uint16_t* src, int width);
+
+  // Fixed point YCbCr to RGB conversion of one row, like DoViProcessor::sample2rgb.
+  // coef holds the 3x3 matrix scaled by 1 << 13, offset the YCbCr offsets.
+  void (*ycc2rgb)(uint16_t* r, uint16_t* g, uint16_t* b, const uint16_t* y, const uint16_t* u, const uint16_t* v,
+                  int width, const int16_t* coef, const uint32_t* offset);
+
+  // PQ LMS to PQ RGB conversion of one row in place, the rows hold the result of ycc2rgb on IPT input.
+  // The LMS codes are linearized with the table, converted with the matrix, clipped to [0, 1] and
+  // brought back to 16 bit PQ with the inverse EOTF of pqInverseEotf.
+  void (*lmsToRgb)(uint16_t* r, uint16_t* g, uint16_t* b, int width, const DoViLmsTables& tables);
+
+  // BL mapping and EL residual of one row looked up in the tables, then reconstructed
+  // like DoViProcessor::signalReconstruction
+  void (*reshape)(uint16_t* dst, const uint16_t* bl, const uint16_t* el, int width, const DoViReshapeTables& tables);
+
+  // L2 trim of one RGB row in place: tone lookup, saturation adjustment and conversion back to PQ.
+  // The power function is approximated, the deviation from powf stays within a few float ulps.
+  void (*trimSaturation)(uint16_t* r, uint16_t* g, uint16_t* b, int width, const DoViTrimTables& tables);
+
+  // Nearest neighbour 2x horizontal upscaling, dst receives 2 * width samples
+  void (*replicate2x)(uint16_t* dst, const uint16_t* src, int width);
+
+  // 16 bit samples mapped through a table of all 65536 codes, to floats or to 16 bit values
+  // like half floats or an EETF, dst may equal src. The 16 bit table needs one extra padding entry at the end.
+  void (*lookupFloat)(float* dst, const uint16_t* src, int width, const float* table);
+  void (*lookup16)(uint16_t* dst, const uint16_t* src, int width, const uint16_t* table);
+
+  // PQ EOTF and inverse EOTF of one row of floats, see DoViPqMath for the accuracy; dst may equal src
+  void (*pqEotf)(float* dst, const float* src, int width);
+  void (*pqInverseEotf)(float* dst, const float* src, int width);
+
+  // Ordered dithering of one row down by shift bits to min((src + thresholds[x % 64]) >> shift, outMax),
+  // the sum saturating at 0xFFFF. dst receives 16 or 8 bit samples.
+  void (*dither16)(uint16_t* dst, const uint16_t* src, int width, const uint16_t* thresholds, int shift, int outMax);
+  void (*dither8)(uint8_t* dst, const uint16_t* src, int width, const uint16_t* thresholds, int shift, int outMax);
+
+  // max(R, G, B) of one RGB row added to the statistics
+  void (*maxRgbStats)(DoViRgbStats& stats, const uint16_t* r, const uint16_t* g, const uint16_t* b, int width);
+
+  static const DoViKernels& get();
+};
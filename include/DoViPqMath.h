@@ -0,0 +1,57 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// SMPTE ST 2084 (PQ) transfer function, with linear light normalized to 10000 nits.
+//
+// eotf / inverseEotf are the exact powf based reference.
+// The tables hold the reference results of every 12 and 16 bit code value and are built on first use.
+// The row functions evaluate the transfer functions on whole rows of floats with the
+// polynomial log2 / exp2 approximations of the DoViKernels, vectorized on AVX2 / AVX-512.
+// Max error against a double precision reference, measured over all 16 bit code values and dense sweeps of [0, 1]:
+//   eotfRow        relative 2.3e-5 (absolute 1e-13 for results below 1e-8), like the float powf reference
+//   inverseEotfRow absolute 1e-5, i.e. 1/25 of a 12 bit code, like the float powf reference
+class DoViPqMath {
+public:
+  static constexpr float m1 = 2610.0 / 4096 / 4;
+  static constexpr float m2 = 2523.0 / 4096 * 128;
+  static constexpr float c3 = 2392.0 / 4096 * 32;
+  static constexpr float c2 = 2413.0 / 4096 * 32;
+  static constexpr float c1 = c3 - c2 + 1;
+
+  static inline float eotf(float ep);
+  static inline float inverseEotf(float Y);
+
+  // eotf(code / 4095.0f) of all 4096 12 bit codes
+  static const float* eotfTable12();
+  // eotf(code / 65535.0f) of all 65536 16 bit codes
+  static const float* eotfTable16();
+  // the table of the given bit depth if there is one, otherwise nullptr
+  static const float* eotfTable(int bitDepth);
+
+  // smallest linear light in nits that DoViProcessor::nits2pq rounds to each 12 bit code,
+  // so a search over it gives the exact code of values up to 10000 nits
+  static const float* nitsToPq12Thresholds();
+
+  // approximated transfer functions of width values, dst may equal src
+  static void eotfRow(float* dst, const float* src, int width);
+  static void inverseEotfRow(float* dst, const float* src, int width);
+};
+
+float DoViPqMath::eotf(float ep)
+{
+  const float epower = powf(ep, 1 / m2);
+  const float num = std::max(epower - c1, 0.0f);
+  const float denom = c2 - c3 * epower;
+  return powf(num / denom, 1 / m1);
+}
+
+float DoViPqMath::inverseEotf(float Y)
+{
+  const float epower = powf(Y, m1);
+  const float num = c1 + c2 * epower;
+  const float denom = 1 + c3 * epower;
+  return powf(num / denom, m2);
+}
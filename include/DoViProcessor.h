@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <vector>
 
 #ifdef _WIN32
@@ -21,6 +22,8 @@
 #include "avisynth.h"
 #pragma warning(pop)
 #include "dovi/rpu_parser.h"
+#include "DoViKernels.h"
+#include "DoViPqMath.h"
 
 class DoViProcessor {
 public:
@@ -37,10 +40,15 @@ public:
   inline void setTrim(uint16_t trimPq, float targetMinNits, float targetMaxNits);
 
   bool intializeFrame(int frame, IScriptEnvironment* env, const uint8_t* rpubuf, size_t rpusize);
+  // whether a frame of the RPU file is profile 5 (IPT) input, always false for integrated RPUs
+  bool hasIptInput() const;
   inline int getClipLength() const { return rpus->len; }
   inline bool isIntegratedRpu() const { return !rpus; }
   inline bool isSceneChange() const { return scene_refresh_flag; }
-  inline bool isLimitedRangeOutput() const { return !signal_full_range_flag; }
+  // the LMS to RGB conversion of IPT input always gives full range RGB
+  inline bool isLimitedRangeOutput() const { return !signal_full_range_flag && !ipt_input; }
+  // profile 5: the reshaped signal is IPT, which ycc2rgb converts to PQ LMS rather than RGB
+  inline bool isIptInput() const { return ipt_input; }
   inline bool elProcessingEnabled() const { return !disable_residual_flag; }
   inline bool trimProcessingEnabled() const { return !skipTrim; }
   inline uint16_t getNlqOffset(int cmp) const { return nlq_offset[cmp] << (outContainerBitDepth - el_bit_depth); }
@@ -52,6 +60,13 @@ public:
   inline uint16_t getStaticMaxAvgContentLightLevel() const { return static_max_avg_content_light_level; }
   inline uint16_t getStaticMasterDisplayMaxLuminance() const { return static_master_display_max_luminance; }
   inline uint16_t getStaticMasterDisplayMinLuminance() const { return static_master_display_min_luminance; }
+  // L5 active area, the widths of the letterbox / pillarbox bars in pixels, all 0 without L5
+  inline uint16_t getActiveAreaLeftOffset() const { return active_area_left_offset; }
+  inline uint16_t getActiveAreaRightOffset() const { return active_area_right_offset; }
+  inline uint16_t getActiveAreaTopOffset() const { return active_area_top_offset; }
+  inline uint16_t getActiveAreaBottomOffset() const { return active_area_bottom_offset; }
+  inline const int16_t* getYccToRgbCoef() const { return ycc_to_rgb_coef; }
+  inline const uint32_t* getYccToRgbOffset() const { return ycc_to_rgb_offset; }
   const std::vector<uint16_t>& getAvailableTrimPqs() const { return availableTrimPqs; }
 
   static inline float EOTF(float ep);
@@ -82,8 +97,18 @@ public:
   inline uint16_t processSampleU(uint16_t bl, uint16_t el, uint16_t mmrBlY, uint16_t mmrBlU, uint16_t mmrBlV) const;
   inline uint16_t processSampleV(uint16_t bl, uint16_t el, uint16_t mmrBlY, uint16_t mmrBlU, uint16_t mmrBlV) const;
 
+  // Row wise processSampleY/U/V using the per frame lookup tables, MMR mapped chroma is processed per sample.
+  // The MMR luma input is read from mmrBlY with a step of mmrStep samples.
+  void processRowY(uint16_t* dst, const uint16_t* bl, const uint16_t* el, int width) const;
+  void processRowU(uint16_t* dst, const uint16_t* blU, const uint16_t* blV, const uint16_t* el, const uint16_t* mmrBlY, int mmrStep, int width) const;
+  void processRowV(uint16_t* dst, const uint16_t* blU, const uint16_t* blV, const uint16_t* el, const uint16_t* mmrBlY, int mmrStep, int width) const;
+
   inline void sample2rgb(uint16_t& r, uint16_t& g, uint16_t& b, const uint16_t& y, const uint16_t& u, const uint16_t& v) const;
   void processTrim(uint16_t& ro, uint16_t& go, uint16_t& bo, const uint16_t& ri, const uint16_t& gi, const uint16_t& bi) const;
+  // processTrim on a whole row in place, using the per scene trim tables
+  void processTrimRow(uint16_t* r, uint16_t* g, uint16_t* b, int width) const;
+  // PQ LMS rows from ycc2rgb on IPT input converted to PQ RGB in place
+  void processLmsRow(uint16_t* r, uint16_t* g, uint16_t* b, int width) const;
 
   static constexpr uint8_t outContainerBitDepth = 16;
 private:
@@ -95,13 +120,13 @@ private:
   uint16_t mmrMapping(int cmp, int pivot_idx, uint64_t sampleY, uint64_t sampleU, uint64_t sampleV) const;
   int16_t nonLinearInverseQuantization(int cmp, uint16_t sample) const;
   uint16_t signalReconstruction(uint16_t v, int16_t r) const;
+  void processRowChroma(int cmp, uint16_t* dst, const uint16_t* blU, const uint16_t* blV, const uint16_t* el, const uint16_t* mmrBlY, int mmrStep, int width) const;
+  void prepareReshapeTables();
+  void prepareLmsTables(const DoviVdrDmData* vdr_dm_data);
   void prepareTrimCoef();
-
-  static constexpr float m1 = 2610.0 / 4096 / 4;
-  static constexpr float m2 = 2523.0 / 4096 * 128;
-  static constexpr float c3 = 2392.0 / 4096 * 32;
-  static constexpr float c2 = 2413.0 / 4096 * 32;
-  static constexpr float c1 = c3 - c2 + 1;
+  void prepareTrimTables();
+  float trimToneCurve(uint16_t pq) const;
+  float trimSlopeOffsetPower(float nits) const;
 
   const DoviRpuOpaqueList* rpus;
   bool ownsRpus;  // Whether this instance should free rpus in destructor
@@ -123,6 +148,7 @@ private:
   bool disable_residual_flag;
   bool scene_refresh_flag;
   bool signal_full_range_flag;
+  bool ipt_input;
 
   uint16_t dynamic_max_pq;
   uint16_t dynamic_min_pq;
@@ -133,6 +159,10 @@ private:
   uint16_t static_max_avg_content_light_level;
   uint16_t static_master_display_max_luminance;
   uint16_t static_master_display_min_luminance;
+  uint16_t active_area_left_offset;
+  uint16_t active_area_right_offset;
+  uint16_t active_area_top_offset;
+  uint16_t active_area_bottom_offset;
   int16_t ycc_to_rgb_coef[9];
   uint32_t ycc_to_rgb_offset[3];
 
@@ -140,6 +170,9 @@ private:
   static const uint16_t ycc_to_rgb_offset_scale_shifts = (28-outContainerBitDepth);
   static const uint16_t rgb_to_lms_coef_scale_shifts = 14;
 
+  // per frame LMS to RGB conversion of IPT input
+  DoViLmsTables lmsTables;
+
   uint8_t num_pivots_minus1[3];
   std::vector<std::vector<uint16_t>> pivot_value;
 
@@ -156,6 +189,12 @@ private:
   uint32_t fp_linear_deadzone_slope[3];
   uint32_t fp_linear_deadzone_threshold[3];
 
+  // per frame lookup tables of the BL mapping and the NLQ, not used for MMR mapped components
+  std::vector<int32_t> blMappingLut[3];
+  std::vector<int32_t> elResidualLut[3];
+  DoViReshapeTables reshapeTables[3];
+  bool mmrMappingUsed[3];
+
   uint16_t desiredTrimPq;
   float targetMaxNits;
   float targetMinNits;
@@ -174,6 +213,12 @@ private:
     float goP[3];
     float cS[2];
   } trim;
+
+  // per scene tables of the trim, only rebuilt when the trim coefficients change
+  std::vector<float> trimToneLut;
+  std::vector<uint16_t> trimDirectLut; // whole trim per input sample if no L2 trim info is available
+  std::array<float, 11> trimTablesKey{};
+  DoViTrimTables trimTables;
 };
 
 void DoViProcessor::setTrim(uint16_t trimPq, float targetMinNits, float targetMaxNits)
@@ -185,22 +230,18 @@ void DoViProcessor::setTrim(uint16_t trimPq, float targetMinNits, float targetMa
 
 float DoViProcessor::EOTF(float ep)
 {
-  const float epower = powf(ep, 1 / m2);
-  const float num = std::max(epower - c1, 0.0f);
-  const float denom = c2 - c3 * epower;
-  return powf(num / denom, 1 / m1);
+  return DoViPqMath::eotf(ep);
 }
 
 float DoViProcessor::EOTFinv(float Y)
 {
-  const float epower = powf(Y, m1);
-  const float num = c1 + c2 * epower;
-  const float denom = 1 + c3 * epower;
-  return powf(num / denom, m2);
+  return DoViPqMath::inverseEotf(Y);
 }
 
 float DoViProcessor::pq2nits(uint16_t pq)
 {
+  if (pq < 4096)
+    return DoViPqMath::eotfTable12()[pq] * 10000;
   const float ep = pq / 4095.0f;
   return EOTF(ep) * 10000;
 }
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dovi/rpu_parser.h"
+
+// Clip-wide summary of an RPU list, gathered in a single scan over all frames
+struct DoViRpuSummary {
+  int frames = 0;
+  // profile and EL type of the first frame, and whether other frames differ from it
+  int profile = 0;
+  std::string elType;
+  bool profileVaries = false;
+  bool elTypeVaries = false;
+  int residualFrames = 0;
+
+  // a frame counts as identity when all curves are no-op polynomials,
+  // as mmr when any chroma curve uses mmr and as poly otherwise
+  int identityMappingFrames = 0;
+  int polyMappingFrames = 0;
+  int mmrMappingFrames = 0;
+
+  std::vector<int> sceneCuts;
+
+  bool hasL1 = false;
+  uint16_t l1MinPq[2] = { 0xFFFF, 0 };
+  uint16_t l1MaxPq[2] = { 0xFFFF, 0 };
+  uint16_t l1AvgPq[2] = { 0xFFFF, 0 };
+
+  bool hasL6 = false;
+  uint16_t l6MaxCll[2] = { 0xFFFF, 0 };
+  uint16_t l6MaxFall[2] = { 0xFFFF, 0 };
+  uint16_t l6MasterMaxLuminance[2] = { 0xFFFF, 0 };
+  uint16_t l6MasterMinLuminance[2] = { 0xFFFF, 0 };
+
+  std::vector<uint16_t> l2TargetPqs;
+
+  // smallest offsets seen on any frame, i.e. the union of all active areas
+  bool hasL5 = false;
+  bool l5Varies = false;
+  uint16_t l5Offsets[4] = { 0, 0, 0, 0 }; // left, right, top, bottom
+
+  std::string error;
+};
+
+class DoViRpuAnalyzer {
+public:
+  // threads <= 0 selects the hardware concurrency
+  static DoViRpuSummary analyze(const DoviRpuOpaqueList* rpus, int threads = 0);
+
+private:
+  static void analyzeRange(const DoviRpuOpaqueList* rpus, size_t first, size_t last, DoViRpuSummary& summary);
+  static void merge(DoViRpuSummary& into, const DoViRpuSummary& from);
+  static bool isIdentityCurve(const DoviReshapingCurve& curve, uint64_t coeffLog2Denom, uint8_t blBitDepth);
+};
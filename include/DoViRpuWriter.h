@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dovi/rpu_parser.h"
+
+// Converts RPUs and re-emits them as HEVC UNSPEC62 NAL units, optionally
+// collecting them into an RPU.bin file in frame order
+class DoViRpuWriter {
+public:
+  DoViRpuWriter() = default;
+  ~DoViRpuWriter();
+
+  // Converts a private copy of the RPU of the given frame, taken either from the rpu list or
+  // from the integrated NAL unit, and serializes it to nalu. The source RPU is left untouched.
+  // mode follows dovi_convert_rpu_with_mode, 0 keeps the RPU as is
+  static bool convert(const DoviRpuOpaqueList* rpus, int frame, const uint8_t* rpubuf, size_t rpusize,
+    uint8_t mode, bool removeMapping, std::vector<uint8_t>& nalu, std::string& error);
+
+  bool open(const char* path, int numFrames, std::string& error);
+  bool isOpen() const { return file.is_open(); }
+
+  // Frames may arrive in any order, they are held back until all preceding frames were written.
+  // The file is removed when it ends up with gaps or missing frames, i.e. when a frame failed,
+  // one was not requested before too many later ones or the clip was not rendered to the end.
+  void write(int frame, std::vector<uint8_t>&& nalu);
+  // The frame has no RPU to write, so the file cannot line up with the video anymore
+  void fail(int frame);
+
+private:
+  void flush();
+  void abandon();
+
+  std::ofstream file;
+  std::filesystem::path path;
+  std::mutex writeMutex;
+  std::map<int, std::vector<uint8_t>> pending;
+  int nextFrame = 0;
+  int numFrames = 0;
+  bool abandoned = false;
+};
@@ -0,0 +1,123 @@
+#include "DoViDither.h"
+#include <cmath>
+
+namespace {
+	constexpr int kSize = DoViDither::size;
+	constexpr int kCount = kSize * kSize;
+
+	std::vector<uint16_t> buildBayerRanks()
+	{
+		// the rank interleaves the bits of x ^ y and y, the lowest coordinate bits becoming the highest rank bits
+		std::vector<uint16_t> ranks(kCount);
+		for (int y = 0; y < kSize; y++) {
+			for (int x = 0; x < kSize; x++) {
+				int rank = 0;
+				for (int bit = 0; bit < 6; bit++)
+					rank = (rank << 2) | ((((x ^ y) >> bit) & 1) << 1) | ((y >> bit) & 1);
+				ranks[y * kSize + x] = static_cast<uint16_t>(rank);
+			}
+		}
+		return ranks;
+	}
+
+	// Void and cluster after Ulichney: the energy of a position is the gaussian weighted count of the set
+	// positions around it on the torus. The initial pattern is relaxed by moving its tightest cluster into
+	// its largest void, then the set positions are ranked by removing the tightest clusters and the free
+	// ones by filling the largest voids.
+	std::vector<uint16_t> buildBlueNoiseRanks()
+	{
+		constexpr int radius = 7;
+		constexpr float sigma = 1.5f;
+		float weights[2 * radius + 1][2 * radius + 1];
+		for (int dy = -radius; dy <= radius; dy++)
+			for (int dx = -radius; dx <= radius; dx++)
+				weights[dy + radius][dx + radius] = std::exp(-(dx * dx + dy * dy) / (2 * sigma * sigma));
+
+		std::vector<uint8_t> pattern(kCount, 0);
+		std::vector<float> energy(kCount, 0.0f);
+		auto toggle = [&](int pos) {
+			pattern[pos] ^= 1;
+			const float sign = pattern[pos] ? 1.0f : -1.0f;
+			const int px = pos % kSize;
+			const int py = pos / kSize;
+			for (int dy = -radius; dy <= radius; dy++)
+				for (int dx = -radius; dx <= radius; dx++)
+					energy[((py + dy) & (kSize - 1)) * kSize + ((px + dx) & (kSize - 1))] += sign * weights[dy + radius][dx + radius];
+		};
+		auto tightestCluster = [&] {
+			int best = -1;
+			for (int pos = 0; pos < kCount; pos++)
+				if (pattern[pos] && (best < 0 || energy[pos] > energy[best]))
+					best = pos;
+			return best;
+		};
+		auto largestVoid = [&] {
+			int best = -1;
+			for (int pos = 0; pos < kCount; pos++)
+				if (!pattern[pos] && (best < 0 || energy[pos] < energy[best]))
+					best = pos;
+			return best;
+		};
+
+		// a tenth of the positions set at random, with a fixed seed so the matrix is always the same
+		int initial = 0;
+		uint32_t seed = 1;
+		while (initial < kCount / 10) {
+			seed = seed * 1664525u + 1013904223u;
+			const int pos = static_cast<int>((seed >> 8) % kCount);
+			if (!pattern[pos]) {
+				toggle(pos);
+				initial++;
+			}
+		}
+		for (int i = 0; i < kCount; i++) {
+			const int cluster = tightestCluster();
+			toggle(cluster);
+			const int gap = largestVoid();
+			toggle(gap);
+			if (gap == cluster)
+				break;
+		}
+
+		std::vector<uint16_t> ranks(kCount);
+		const std::vector<uint8_t> initialPattern = pattern;
+		const std::vector<float> initialEnergy = energy;
+		for (int rank = initial - 1; rank >= 0; rank--) {
+			const int cluster = tightestCluster();
+			toggle(cluster);
+			ranks[cluster] = static_cast<uint16_t>(rank);
+		}
+		pattern = initialPattern;
+		energy = initialEnergy;
+		for (int rank = initial; rank < kCount; rank++) {
+			const int gap = largestVoid();
+			toggle(gap);
+			ranks[gap] = static_cast<uint16_t>(rank);
+		}
+		return ranks;
+	}
+}
+
+const uint16_t* DoViDither::bayerRanks()
+{
+	static const std::vector<uint16_t> ranks = buildBayerRanks();
+	return ranks.data();
+}
+
+const uint16_t* DoViDither::blueNoiseRanks()
+{
+	static const std::vector<uint16_t> ranks = buildBlueNoiseRanks();
+	return ranks.data();
+}
+
+std::vector<uint16_t> DoViDither::thresholds(Type type, int shift)
+{
+	std::vector<uint16_t> thresholds(kCount, static_cast<uint16_t>((1 << shift) >> 1));
+	if (type == none)
+		return thresholds;
+	// the centers of kCount equal steps, so the average threshold is half a step like with rounding
+	const uint16_t* ranks = type == ordered ? bayerRanks() : blueNoiseRanks();
+	for (int i = 0; i < kCount; i++)
+		thresholds[i] = static_cast<uint16_t>(((2 * ranks[i] + 1) << shift) / (2 * kCount));
+	return thresholds;
+}
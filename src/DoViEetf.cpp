@@ -1,6 +1,7 @@
 #include "DoViEetf.h"
-#include "DoViProcessor.h"
+#include "DoViPqMath.h"
 #include <algorithm>
+#include <vector>
 
 template<int signalBitDepth>
 DoViEetf<signalBitDepth>::DoViEetf(float kneeOffset_, bool normalizeOutput_)
@@ -24,8 +25,8 @@ void DoViEetf<signalBitDepth>::generateEETF(
 	bool limitedInput)
 {
 	// based on report ITU-R BT.2408-7 Annex 5 (was in ITU-R BT.2390 until revision 7)
-	float masterMaxEp = DoViProcessor::EOTFinv(DoViProcessor::EOTF(masterMaxPq / 4095.0f) * lumScale);
-	float masterMinEp = DoViProcessor::EOTFinv(DoViProcessor::EOTF(masterMinPq / 4095.0f) * lumScale);
+	float masterMaxEp = DoViPqMath::inverseEotf(DoViPqMath::eotf(masterMaxPq / 4095.0f) * lumScale);
+	float masterMinEp = DoViPqMath::inverseEotf(DoViPqMath::eotf(masterMinPq / 4095.0f) * lumScale);
 	const float targetMaxEp = targetMaxPq / 4095.0f;
 	const float targetMinEp = targetMinPq / 4095.0f;
 
@@ -62,15 +63,30 @@ void DoViEetf<signalBitDepth>::generateEETF(
 		outWhite = targetMaxEp * (LUT_SIZE - 1) + 0.5f;
 	}
 
+	// the luminosity scaling of the whole processed range goes through the vectorized transfer functions at once,
+	// full range 12 and 16 bit signals take the linear light straight from the exact tables
+	const int inCount = std::max(inMaxSignal - inMinSignal, 0);
+	const float* eotfTable = limitedInput ? nullptr : DoViPqMath::eotfTable(signalBitDepth);
+	std::vector<float> scaledEp(inCount);
+	for (int i = 0; i < inCount; i++) {
+		const int s = inMinSignal + i;
+		scaledEp[i] = eotfTable ? eotfTable[s] : (s - inBlack) / float(inWhite - inBlack);
+	}
+	if (!eotfTable) {
+		DoViPqMath::eotfRow(scaledEp.data(), scaledEp.data(), inCount);
+	}
+	for (float& e : scaledEp) {
+		e *= lumScale;
+	}
+	DoViPqMath::inverseEotfRow(scaledEp.data(), scaledEp.data(), inCount);
+
 	int inSignal = 0;
 	for (; inSignal < inMinSignal; inSignal++) {
 		// skip unnecessary processing where result is known
 		lut[inSignal] = outBlack;
 	}
 	for (; inSignal < inMaxSignal; inSignal++) {
-		float ep = (inSignal - inBlack) / float(inWhite - inBlack);
-		float e = DoViProcessor::EOTF(ep) * lumScale;
-		ep = DoViProcessor::EOTFinv(e);
+		const float ep = scaledEp[inSignal - inMinSignal];
 		float e1 = (ep - masterMinEp) / (masterMaxEp - masterMinEp);
 
 		// This following clamping is not from the report.
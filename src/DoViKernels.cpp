@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "DoViKernelsImpl.h"
+#include "DoViProcessor.h"
+
+#ifdef DOVI_KERNELS_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+void upsampleLumaVertRange_c(uint16_t* dst, const uint16_t* const* src, int begin, int end, bool odd)
+{
+	uint16_t value[5];
+	for (int w = begin; w < end; w++) {
+		for (int i = 0; i < 5; i++)
+			value[i] = src[i][w];
+		dst[w] = odd ? DoViProcessor::upsampleLumaOdd(value, 2) : DoViProcessor::upsampleLumaEven(value, 2);
+	}
+}
+
+void upsampleChromaVertRange_c(uint16_t* dst, const uint16_t* const* src, int begin, int end, bool odd)
+{
+	if (!odd) {
+		std::copy(src[1] + begin, src[1] + end, dst + begin);
+		return;
+	}
+	uint16_t value[4];
+	for (int w = begin; w < end; w++) {
+		for (int i = 0; i < 4; i++)
+			value[i] = src[i][w];
+		dst[w] = DoViProcessor::upsampleChromaOdd(value, 1);
+	}
+}
+
+void upsampleLumaHorzRange_c(uint16_t* dst, const uint16_t* src, int width, int begin, int end)
+{
+	uint16_t value[5];
+	for (int w = begin; w < end; w++) {
+		const uint16_t* taps = value;
+		if (w < 2 || w > width - 3) {
+			for (int i = 0; i < 5; i++)
+				value[i] = src[std::clamp(w + i - 2, 0, width - 1)];
+		}
+		else {
+			taps = src + w - 2;
+		}
+		dst[2 * w] = DoViProcessor::upsampleLumaEven(taps, 2);
+		dst[2 * w + 1] = DoViProcessor::upsampleLumaOdd(taps, 2);
+	}
+}
+
+void upsampleChromaHorzRange_c(uint16_t* dst, const uint16_t* src, int width, int begin, int end)
+{
+	uint16_t value[4];
+	for (int w = begin; w < end; w++) {
+		const uint16_t* taps = value;
+		if (w < 1 || w > width - 3) {
+			for (int i = 0; i < 4; i++)
+				value[i] = src[std::clamp(w + i - 1, 0, width - 1)];
+		}
+		else {
+			taps = src + w - 1;
+		}
+		dst[2 * w] = DoViProcessor::upsampleChromaEven(taps, 1);
+		dst[2 * w + 1] = DoViProcessor::upsampleChromaOdd(taps, 1);
+	}
+}
+
+void upsampleLumaVertBilinearRange_c(uint16_t* dst, const uint16_t* const* src, int begin, int end, bool odd)
+{
+	// 1/4 of the row above or below the center row
+	const uint16_t* outer = odd ? src[3] : src[1];
+	for (int w = begin; w < end; w++)
+		dst[w] = static_cast<uint16_t>((outer[w] + 3 * src[2][w] + 2) >> 2);
+}
+
+void upsampleChromaVertBilinearRange_c(uint16_t* dst, const uint16_t* const* src, int begin, int end, bool odd)
+{
+	if (!odd) {
+		std::copy(src[1] + begin, src[1] + end, dst + begin);
+		return;
+	}
+	for (int w = begin; w < end; w++)
+		dst[w] = static_cast<uint16_t>((src[1][w] + src[2][w] + 1) >> 1);
+}
+
+void upsampleLumaHorzBilinearRange_c(uint16_t* dst, const uint16_t* src, int width, int begin, int end)
+{
+	for (int w = begin; w < end; w++) {
+		const int left = src[std::max(w - 1, 0)];
+		const int right = src[std::min(w + 1, width - 1)];
+		dst[2 * w] = static_cast<uint16_t>((left + 3 * src[w] + 2) >> 2);
+		dst[2 * w + 1] = static_cast<uint16_t>((3 * src[w] + right + 2) >> 2);
+	}
+}
+
+void upsampleChromaHorzBilinearRange_c(uint16_t* dst, const uint16_t* src, int width, int begin, int end)
+{
+	for (int w = begin; w < end; w++) {
+		const int right = src[std::min(w + 1, width - 1)];
+		dst[2 * w] = src[w];
+		dst[2 * w + 1] = static_cast<uint16_t>((src[w] + right + 1) >> 1);
+	}
+}
+
+void ycc2rgbRange_c(uint16_t* r, uint16_t* g, uint16_t* b, const uint16_t* y, const uint16_t* u, const uint16_t* v,
+	int begin, int end, const int16_t* coef, const uint32_t* offset)
+{
+	auto clip = [](int value) { return static_cast<uint16_t>(std::clamp(value, 0, 0xFFFF)); };
+	for (int w = begin; w < end; w++) {
+		const int yf = y[w] - offset[0];
+		const int uf = u[w] - offset[1];
+		const int vf = v[w] - offset[2];
+		r[w] = clip((coef[0] * yf + coef[1] * uf + coef[2] * vf) >> 13);
+		g[w] = clip((coef[3] * yf + coef[4] * uf + coef[5] * vf) >> 13);
+		b[w] = clip((coef[6] * yf + coef[7] * uf + coef[8] * vf) >> 13);
+	}
+}
+
+void reshapeRange_c(uint16_t* dst, const uint16_t* bl, const uint16_t* el, int begin, int end, const DoViReshapeTables& tables)
+{
+	for (int w = begin; w < end; w++) {
+		int h = tables.blMapping[std::min(bl[w] >> tables.blShift, tables.blMaxIndex)];
+		if (tables.elResidual)
+			h += tables.elResidual[std::min(el[w] >> tables.elShift, tables.elMaxIndex)];
+		h = std::clamp(h >> tables.outShift, 0, tables.outMax);
+		dst[w] = h << tables.outShift;
+	}
+}
+
+namespace {
+	float log2Approx(float x)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+		float e = static_cast<float>(static_cast<int>(bits >> 23) - 127);
+		const uint32_t mbits = (bits & 0x7FFFFF) | 0x3F800000;
+		float m;
+		std::memcpy(&m, &mbits, sizeof(m));
+		if (m > 1.41421356f) {
+			m *= 0.5f;
+			e += 1.0f;
+		}
+		const float t = (m - 1.0f) / (m + 1.0f);
+		const float t2 = t * t;
+		float p = std::fma(kLog2Coef[4], t2, kLog2Coef[3]);
+		p = std::fma(p, t2, kLog2Coef[2]);
+		p = std::fma(p, t2, kLog2Coef[1]);
+		p = std::fma(p, t2, kLog2Coef[0]);
+		return std::fma(p, t, e);
+	}
+
+	float exp2Approx(float y)
+	{
+		// written like the SIMD min / max, which return the constant for NaN
+		y = (y > -126.0f) ? y : -126.0f;
+		y = (y < 127.0f) ? y : 127.0f;
+		const float n = std::nearbyint(y);
+		const float f = y - n;
+		float p = kExp2Coef[7];
+		for (int i = 6; i >= 0; i--)
+			p = std::fma(p, f, kExp2Coef[i]);
+		const uint32_t sbits = static_cast<uint32_t>(static_cast<int>(n) + 127) << 23;
+		float scale;
+		std::memcpy(&scale, &sbits, sizeof(scale));
+		return p * scale;
+	}
+
+	// branchless search of the PQ code, NaN ends up at code 0
+	int nitsToPq(const float* thresholds, float nits)
+	{
+		int idx = 0;
+		for (int step = 2048; step > 0; step >>= 1)
+			idx += (thresholds[idx + step] <= nits) ? step : 0;
+		return idx;
+	}
+
+	// x^p for x > 0, written like the SIMD variants which clamp to the smallest normal float
+	// and zero the result of zero, negative and NaN inputs
+	float powApprox(float x, float p)
+	{
+		if (!(x > 0.0f))
+			return 0.0f;
+		x = (x > FLT_MIN) ? x : FLT_MIN;
+		return exp2Approx(p * log2Approx(x));
+	}
+
+	float pqInverseEotfApprox(float y)
+	{
+		const float epower = powApprox(y, DoViPqMath::m1);
+		const float num = std::fma(DoViPqMath::c2, epower, DoViPqMath::c1);
+		const float denom = std::fma(DoViPqMath::c3, epower, 1.0f);
+		return powApprox(num / denom, DoViPqMath::m2);
+	}
+}
+
+void trimSaturationRange_c(uint16_t* r, uint16_t* g, uint16_t* b, int begin, int end, const DoViTrimTables& tables)
+{
+	for (int w = begin; w < end; w++) {
+		uint16_t* rgb[3] = { r + w, g + w, b + w };
+		float f[3];
+		for (int c = 0; c < 3; c++)
+			f[c] = tables.tone[*rgb[c] >> tables.inShift];
+		const float y = std::fma(kTrimLumaWeight[2], f[2], std::fma(kTrimLumaWeight[1], f[1], kTrimLumaWeight[0] * f[0]));
+		for (int c = 0; c < 3; c++) {
+			const float gain = exp2Approx(tables.saturationGain * log2Approx(tables.chromaWeight * f[c] / y));
+			*rgb[c] = static_cast<uint16_t>(nitsToPq(tables.pqThresholds, f[c] * gain) << tables.outShift);
+		}
+	}
+}
+
+void lookupFloatRange_c(float* dst, const uint16_t* src, int begin, int end, const float* table)
+{
+	for (int w = begin; w < end; w++)
+		dst[w] = table[src[w]];
+}
+
+void lookup16Range_c(uint16_t* dst, const uint16_t* src, int begin, int end, const uint16_t* table)
+{
+	for (int w = begin; w < end; w++)
+		dst[w] = table[src[w]];
+}
+
+void pqEotfRange_c(float* dst, const float* src, int begin, int end)
+{
+	for (int w = begin; w < end; w++) {
+		const float epower = powApprox(src[w], 1 / DoViPqMath::m2);
+		float num = epower - DoViPqMath::c1;
+		num = (num > 0.0f) ? num : 0.0f;
+		const float denom = std::fma(-DoViPqMath::c3, epower, DoViPqMath::c2);
+		dst[w] = powApprox(num / denom, 1 / DoViPqMath::m1);
+	}
+}
+
+void pqInverseEotfRange_c(float* dst, const float* src, int begin, int end)
+{
+	for (int w = begin; w < end; w++)
+		dst[w] = pqInverseEotfApprox(src[w]);
+}
+
+void lmsToRgbRange_c(uint16_t* r, uint16_t* g, uint16_t* b, int begin, int end, const DoViLmsTables& tables)
+{
+	const float* m = tables.lmsToRgb;
+	for (int w = begin; w < end; w++) {
+		const float lms[3] = { tables.eotf[r[w]], tables.eotf[g[w]], tables.eotf[b[w]] };
+		uint16_t* rgb[3] = { r + w, g + w, b + w };
+		for (int c = 0; c < 3; c++) {
+			float x = std::fma(m[3 * c + 2], lms[2], std::fma(m[3 * c + 1], lms[1], m[3 * c] * lms[0]));
+			x = (x > 0.0f) ? x : 0.0f;
+			x = (x < 1.0f) ? x : 1.0f;
+			*rgb[c] = static_cast<uint16_t>(std::min(static_cast<int>(std::fma(pqInverseEotfApprox(x), 65535.0f, 0.5f)), 0xFFFF));
+		}
+	}
+}
+
+void dither16Range_c(uint16_t* dst, const uint16_t* src, int begin, int end, const uint16_t* thresholds, int shift, int outMax)
+{
+	for (int w = begin; w < end; w++)
+		dst[w] = static_cast<uint16_t>(std::min(std::min(src[w] + thresholds[w & 63], 0xFFFF) >> shift, outMax));
+}
+
+void dither8Range_c(uint8_t* dst, const uint16_t* src, int begin, int end, const uint16_t* thresholds, int shift, int outMax)
+{
+	for (int w = begin; w < end; w++)
+		dst[w] = static_cast<uint8_t>(std::min(std::min(src[w] + thresholds[w & 63], 0xFFFF) >> shift, outMax));
+}
+
+void maxRgbStatsRange_c(DoViRgbStats& stats, const uint16_t* r, const uint16_t* g, const uint16_t* b, int begin, int end)
+{
+	for (int w = begin; w < end; w++) {
+		const uint32_t m = std::max(r[w], std::max(g[w], b[w]));
+		stats.sum += m;
+		stats.min = std::min(stats.min, m);
+		stats.max = std::max(stats.max, m);
+		stats.histogram[m >> 10]++;
+	}
+	stats.count += end - begin;
+}
+
+void replicate2xRange_c(uint16_t* dst, const uint16_t* src, int begin, int end)
+{
+	for (int w = begin; w < end; w++) {
+		dst[2 * w] = src[w];
+		dst[2 * w + 1] = src[w];
+	}
+}
+
+namespace {
+	void upsampleLumaVert_c(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		upsampleLumaVertRange_c(dst, src, 0, width, odd);
+	}
+
+	void upsampleChromaVert_c(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		upsampleChromaVertRange_c(dst, src, 0, width, odd);
+	}
+
+	void upsampleLumaHorz_c(uint16_t* dst, const uint16_t* src, int width)
+	{
+		upsampleLumaHorzRange_c(dst, src, width, 0, width);
+	}
+
+	void upsampleChromaHorz_c(uint16_t* dst, const uint16_t* src, int width)
+	{
+		upsampleChromaHorzRange_c(dst, src, width, 0, width);
+	}
+
+	void ycc2rgb_c(uint16_t* r, uint16_t* g, uint16_t* b, const uint16_t* y, const uint16_t* u, const uint16_t* v,
+		int width, const int16_t* coef, const uint32_t* offset)
+	{
+		ycc2rgbRange_c(r, g, b, y, u, v, 0, width, coef, offset);
+	}
+
+	void reshape_c(uint16_t* dst, const uint16_t* bl, const uint16_t* el, int width, const DoViReshapeTables& tables)
+	{
+		reshapeRange_c(dst, bl, el, 0, width, tables);
+	}
+
+	void trimSaturation_c(uint16_t* r, uint16_t* g, uint16_t* b, int width, const DoViTrimTables& tables)
+	{
+		trimSaturationRange_c(r, g, b, 0, width, tables);
+	}
+
+	void lmsToRgb_c(uint16_t* r, uint16_t* g, uint16_t* b, int width, const DoViLmsTables& tables)
+	{
+		lmsToRgbRange_c(r, g, b, 0, width, tables);
+	}
+
+	void upsampleLumaVertBilinear_c(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		upsampleLumaVertBilinearRange_c(dst, src, 0, width, odd);
+	}
+
+	void upsampleChromaVertBilinear_c(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		upsampleChromaVertBilinearRange_c(dst, src, 0, width, odd);
+	}
+
+	void upsampleLumaHorzBilinear_c(uint16_t* dst, const uint16_t* src, int width)
+	{
+		upsampleLumaHorzBilinearRange_c(dst, src, width, 0, width);
+	}
+
+	void upsampleChromaHorzBilinear_c(uint16_t* dst, const uint16_t* src, int width)
+	{
+		upsampleChromaHorzBilinearRange_c(dst, src, width, 0, width);
+	}
+
+	void replicate2x_c(uint16_t* dst, const uint16_t* src, int width)
+	{
+		replicate2xRange_c(dst, src, 0, width);
+	}
+
+	void lookupFloat_c(float* dst, const uint16_t* src, int width, const float* table)
+	{
+		lookupFloatRange_c(dst, src, 0, width, table);
+	}
+
+	void lookup16_c(uint16_t* dst, const uint16_t* src, int width, const uint16_t* table)
+	{
+		lookup16Range_c(dst, src, 0, width, table);
+	}
+
+	void pqEotf_c(float* dst, const float* src, int width)
+	{
+		pqEotfRange_c(dst, src, 0, width);
+	}
+
+	void pqInverseEotf_c(float* dst, const float* src, int width)
+	{
+		pqInverseEotfRange_c(dst, src, 0, width);
+	}
+
+	void dither16_c(uint16_t* dst, const uint16_t* src, int width, const uint16_t* thresholds, int shift, int outMax)
+	{
+		dither16Range_c(dst, src, 0, width, thresholds, shift, outMax);
+	}
+
+	void dither8_c(uint8_t* dst, const uint16_t* src, int width, const uint16_t* thresholds, int shift, int outMax)
+	{
+		dither8Range_c(dst, src, 0, width, thresholds, shift, outMax);
+	}
+
+	void maxRgbStats_c(DoViRgbStats& stats, const uint16_t* r, const uint16_t* g, const uint16_t* b, int width)
+	{
+		maxRgbStatsRange_c(stats, r, g, b, 0, width);
+	}
+
+#ifdef DOVI_KERNELS_X86
+	struct CpuFeatures {
+		bool avx2 = false;
+		bool avx512 = false;
+	};
+
+	CpuFeatures detectCpu()
+	{
+		CpuFeatures features;
+#ifdef _MSC_VER
+		int regs[4];
+		__cpuid(regs, 0);
+		if (regs[0] < 7)
+			return features;
+		__cpuid(regs, 1);
+		const bool osxsave = regs[2] & (1 << 27);
+		const bool avx = regs[2] & (1 << 28);
+		const bool fma = regs[2] & (1 << 12);
+		const bool f16c = regs[2] & (1 << 29);
+		if (!osxsave || !avx)
+			return features;
+		const unsigned long long xcr0 = _xgetbv(0);
+		__cpuidex(regs, 7, 0);
+		// the OS has to save the ymm and, for AVX-512, the opmask and zmm registers
+		features.avx2 = (xcr0 & 0x6) == 0x6 && (regs[1] & (1 << 5)) && fma && f16c;
+		features.avx512 = features.avx2 && (xcr0 & 0xE6) == 0xE6 &&
+			(regs[1] & (1 << 16)) && (regs[1] & (1 << 17)) && (regs[1] & (1 << 30)) && (regs[1] & (1u << 31));
+#else
+		__builtin_cpu_init();
+		features.avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+		features.avx512 = features.avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+			__builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+#endif
+		return features;
+	}
+#endif
+
+	DoViKernels selectKernels()
+	{
+		DoViKernels kernels;
+		kernels.upsampleLumaVert = upsampleLumaVert_c;
+		kernels.upsampleChromaVert = upsampleChromaVert_c;
+		kernels.upsampleLumaHorz = upsampleLumaHorz_c;
+		kernels.upsampleChromaHorz = upsampleChromaHorz_c;
+		kernels.upsampleLumaVertBilinear = upsampleLumaVertBilinear_c;
+		kernels.upsampleChromaVertBilinear = upsampleChromaVertBilinear_c;
+		kernels.upsampleLumaHorzBilinear = upsampleLumaHorzBilinear_c;
+		kernels.upsampleChromaHorzBilinear = upsampleChromaHorzBilinear_c;
+		kernels.ycc2rgb = ycc2rgb_c;
+		kernels.lmsToRgb = lmsToRgb_c;
+		kernels.reshape = reshape_c;
+		kernels.trimSaturation = trimSaturation_c;
+		kernels.replicate2x = replicate2x_c;
+		kernels.lookupFloat = lookupFloat_c;
+		kernels.lookup16 = lookup16_c;
+		kernels.pqEotf = pqEotf_c;
+		kernels.pqInverseEotf = pqInverseEotf_c;
+		kernels.dither16 = dither16_c;
+		kernels.dither8 = dither8_c;
+		kernels.maxRgbStats = maxRgbStats_c;
+#ifdef DOVI_KERNELS_X86
+		const CpuFeatures cpu = detectCpu();
+		if (cpu.avx2)
+			initKernelsAvx2(kernels);
+		if (cpu.avx512)
+			initKernelsAvx512(kernels);
+#endif
+		return kernels;
+	}
+}
+
+const DoViKernels& DoViKernels::get()
+{
+	static const DoViKernels kernels = selectKernels();
+	return kernels;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "DoViKernels.h"
+#include "DoViPqMath.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define DOVI_KERNELS_X86
+#endif
+
+// Portable kernels working on the sub range [begin, end) of a row.
+// The SIMD variants use them for the clamped edges and the leftover tail.
+void upsampleLumaVertRange_c(uint16_t* dst, const uint16_t* const* src, int begin, int end, bool odd);
+void upsampleChromaVertRange_c(uint16_t* dst, const uint16_t* const* src, int begin, int end, bool odd);
+void upsampleLumaHorzRange_c(uint16_t* dst, const uint16_t* src, int width, int begin, int end);
+void upsampleChromaHorzRange_c(uint16_t* dst, const uint16_t* src, int width, int begin, int end);
+void upsampleLumaVertBilinearRange_c(uint16_t* dst, const uint16_t* const* src, int begin, int end, bool odd);
+void upsampleChromaVertBilinearRange_c(uint16_t* dst, const uint16_t* const* src, int begin, int end, bool odd);
+void upsampleLumaHorzBilinearRange_c(uint16_t* dst, const uint16_t* src, int width, int begin, int end);
+void upsampleChromaHorzBilinearRange_c(uint16_t* dst, const uint16_t* src, int width, int begin, int end);
+void ycc2rgbRange_c(uint16_t* r, uint16_t* g, uint16_t* b, const uint16_t* y, const uint16_t* u, const uint16_t* v,
+	int begin, int end, const int16_t* coef, const uint32_t* offset);
+void lmsToRgbRange_c(uint16_t* r, uint16_t* g, uint16_t* b, int begin, int end, const DoViLmsTables& tables);
+void reshapeRange_c(uint16_t* dst, const uint16_t* bl, const uint16_t* el, int begin, int end, const DoViReshapeTables& tables);
+void trimSaturationRange_c(uint16_t* r, uint16_t* g, uint16_t* b, int begin, int end, const DoViTrimTables& tables);
+void replicate2xRange_c(uint16_t* dst, const uint16_t* src, int begin, int end);
+void lookupFloatRange_c(float* dst, const uint16_t* src, int begin, int end, const float* table);
+void lookup16Range_c(uint16_t* dst, const uint16_t* src, int begin, int end, const uint16_t* table);
+void pqEotfRange_c(float* dst, const float* src, int begin, int end);
+void pqInverseEotfRange_c(float* dst, const float* src, int begin, int end);
+void dither16Range_c(uint16_t* dst, const uint16_t* src, int begin, int end, const uint16_t* thresholds, int shift, int outMax);
+void dither8Range_c(uint8_t* dst, const uint16_t* src, int begin, int end, const uint16_t* thresholds, int shift, int outMax);
+void maxRgbStatsRange_c(DoViRgbStats& stats, const uint16_t* r, const uint16_t* g, const uint16_t* b, int begin, int end);
+
+// Constants of the power function approximation used by trimSaturation and the PQ kernels, shared by all variants
+// so they evaluate the same operations in the same order.
+// log2 of the mantissa in [sqrt(0.5), sqrt(2)) as 2 / ln(2) * atanh(t), t = (m - 1) / (m + 1), up to t^9
+constexpr float kLog2Coef[5] = { 2.885390082f, 0.9617966940f, 0.5770780164f, 0.4121985831f, 0.3205988980f };
+// 2^f for f in [-0.5, 0.5] as Taylor series of exp(f * ln(2)) up to f^7
+constexpr float kExp2Coef[8] = { 1.0f, 0.6931471806f, 0.2402265070f, 0.05550410866f, 0.009618129108f,
+	0.001333355815f, 0.0001540353039f, 0.00001525273380f };
+// luma weights of the saturation adjustment
+constexpr float kTrimLumaWeight[3] = { 0.22897f, 0.69174f, 0.07929f };
+
+#ifdef DOVI_KERNELS_X86
+void initKernelsAvx2(DoViKernels& kernels);
+void initKernelsAvx512(DoViKernels& kernels);
+#endif
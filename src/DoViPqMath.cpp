@@ -0,0 +1,78 @@
+#include "DoViPqMath.h"
+#include "DoViProcessor.h"
+#include "DoViKernels.h"
+#include <cstring>
+#include <vector>
+
+namespace {
+	std::vector<float> buildEotfTable(int bitDepth)
+	{
+		const int maxCode = (1 << bitDepth) - 1;
+		const float scale = static_cast<float>(maxCode);
+		std::vector<float> table(maxCode + 1);
+		for (int code = 0; code <= maxCode; code++)
+			table[code] = DoViPqMath::eotf(code / scale);
+		return table;
+	}
+}
+
+const float* DoViPqMath::eotfTable12()
+{
+	static const std::vector<float> table = buildEotfTable(12);
+	return table.data();
+}
+
+const float* DoViPqMath::eotfTable16()
+{
+	static const std::vector<float> table = buildEotfTable(16);
+	return table.data();
+}
+
+const float* DoViPqMath::eotfTable(int bitDepth)
+{
+	switch (bitDepth) {
+	case 12:
+		return eotfTable12();
+	case 16:
+		return eotfTable16();
+	default:
+		return nullptr;
+	}
+}
+
+// Found by bisection over the float bit patterns. Values beyond the last code end up at code 4095.
+const float* DoViPqMath::nitsToPq12Thresholds()
+{
+	static const std::vector<float> thresholds = [] {
+		auto asFloat = [](uint32_t bits) { float f; std::memcpy(&f, &bits, sizeof(f)); return f; };
+		const float upper = 20000.0f;
+		uint32_t upperBits;
+		std::memcpy(&upperBits, &upper, sizeof(upperBits));
+
+		std::vector<float> t(4096, 0.0f);
+		uint32_t lo = 0; // nits2pq(lo) < code <= nits2pq(hi)
+		for (int code = 1; code < 4096; code++) {
+			uint32_t hi = upperBits;
+			while (hi - lo > 1) {
+				const uint32_t mid = lo + (hi - lo) / 2;
+				if (DoViProcessor::nits2pq(asFloat(mid)) >= code)
+					hi = mid;
+				else
+					lo = mid;
+			}
+			t[code] = asFloat(hi);
+		}
+		return t;
+	}();
+	return thresholds.data();
+}
+
+void DoViPqMath::eotfRow(float* dst, const float* src, int width)
+{
+	DoViKernels::get().pqEotf(dst, src, width);
+}
+
+void DoViPqMath::inverseEotfRow(float* dst, const float* src, int width)
+{
+	DoViKernels::get().pqInverseEotf(dst, src, width);
+}
@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstring>
 #include <string>
 
 #include "DoViProcessor.h"
@@ -15,11 +17,16 @@ DoViProcessor::DoViProcessor(const char* rpuPath, IScriptEnvironment* env, uint8
 	, blContainerBitDepth(blContainerBits)
 	, elContainerBitDepth(elContainerBits)
 	, sourceProfile(sourceProfile)
+	, ipt_input(false)
 	, static_max_pq(0)
 	, static_max_content_light_level(0)
 	, static_max_avg_content_light_level(0)
 	, static_master_display_max_luminance(0)
 	, static_master_display_min_luminance(0)
+	, active_area_left_offset(0)
+	, active_area_right_offset(0)
+	, active_area_top_offset(0)
+	, active_area_bottom_offset(0)
 {
 	ycc_to_rgb_coef[0] = 8192;
 	ycc_to_rgb_coef[1] = 0;
@@ -68,11 +75,16 @@ DoViProcessor::DoViProcessor(const DoviRpuOpaqueList* sharedRpus, uint8_t blCont
 	, blContainerBitDepth(blContainerBits)
 	, elContainerBitDepth(elContainerBits)
 	, sourceProfile(sourceProfile)
+	, ipt_input(false)
 	, static_max_pq(0)
 	, static_max_content_light_level(0)
 	, static_max_avg_content_light_level(0)
 	, static_master_display_max_luminance(0)
 	, static_master_display_min_luminance(0)
+	, active_area_left_offset(0)
+	, active_area_right_offset(0)
+	, active_area_top_offset(0)
+	, active_area_bottom_offset(0)
 {
 	ycc_to_rgb_coef[0] = 8192;
 	ycc_to_rgb_coef[1] = 0;
@@ -116,6 +128,23 @@ void DoViProcessor::showMessage(const char* message, IScriptEnvironment* env)
 		printf(message);
 }
 
+bool DoViProcessor::hasIptInput() const {
+	if (sourceProfile == 5)
+		return true;
+	if (!rpus || sourceProfile != 0)
+		return false;
+	for (size_t i = 0; i < rpus->len; i++) {
+		const DoviRpuDataHeader* header = dovi_rpu_get_header(rpus->list[i]);
+		if (!header)
+			continue;
+		const bool ipt = header->guessed_profile == 5;
+		dovi_rpu_free_header(header);
+		if (ipt)
+			return true;
+	}
+	return false;
+}
+
 bool DoViProcessor::intializeFrame(int frame, IScriptEnvironment* env, const uint8_t* rpubuf, size_t rpusize) {
 	DoviRpuOpaque* rpu;
 	if (rpus) {
@@ -146,6 +175,11 @@ bool DoViProcessor::intializeFrame(int frame, IScriptEnvironment* env, const uin
 	bl_bit_depth = header->bl_bit_depth_minus8 + 8;
 	el_bit_depth = header->el_bit_depth_minus8 + 8;
 	coeff_log2_denom = header->coefficient_log2_denom;
+
+	// Determine effective profile: use sourceProfile if specified, otherwise use auto-detected
+	int effectiveProfile = (sourceProfile == 5 || sourceProfile == 7 || sourceProfile == 8) ? sourceProfile : header->guessed_profile;
+	ipt_input = effectiveProfile == 5;
+
 	disable_residual_flag = header->disable_residual_flag;
 
 	if (blContainerBitDepth < bl_bit_depth) {
@@ -244,6 +278,9 @@ bool DoViProcessor::intializeFrame(int frame, IScriptEnvironment* env, const uin
 
 		scene_refresh_flag = vdr_dm_data->scene_refresh_flag;
 		signal_full_range_flag = vdr_dm_data->signal_full_range_flag;
+		if (ipt_input) {
+			prepareLmsTables(vdr_dm_data);
+		}
 
 		dynamic_min_pq = vdr_dm_data->dm_data.level1->min_pq;
 		dynamic_max_pq = vdr_dm_data->dm_data.level1->max_pq;
@@ -255,6 +292,16 @@ bool DoViProcessor::intializeFrame(int frame, IScriptEnvironment* env, const uin
 			static_master_display_min_luminance = vdr_dm_data->dm_data.level6->min_display_mastering_luminance;
 			static_max_pq = nits2pq(vdr_dm_data->dm_data.level6->max_content_light_level);
 		}
+		active_area_left_offset = 0;
+		active_area_right_offset = 0;
+		active_area_top_offset = 0;
+		active_area_bottom_offset = 0;
+		if (vdr_dm_data->dm_data.level5) {
+			active_area_left_offset = vdr_dm_data->dm_data.level5->active_area_left_offset;
+			active_area_right_offset = vdr_dm_data->dm_data.level5->active_area_right_offset;
+			active_area_top_offset = vdr_dm_data->dm_data.level5->active_area_top_offset;
+			active_area_bottom_offset = vdr_dm_data->dm_data.level5->active_area_bottom_offset;
+		}
 
 		skipTrim = true;
 		if (desiredTrimPq) {
@@ -275,6 +322,7 @@ bool DoViProcessor::intializeFrame(int frame, IScriptEnvironment* env, const uin
 				trim.tone_detail = lvl2.list[i]->ms_weight;
 			}
 			prepareTrimCoef();
+			prepareTrimTables();
 		}
 
 		dovi_rpu_free_vdr_dm_data(vdr_dm_data);
@@ -284,9 +332,6 @@ bool DoViProcessor::intializeFrame(int frame, IScriptEnvironment* env, const uin
 		return false;
 	}
 
-	// Determine effective profile: use sourceProfile if specified, otherwise use auto-detected
-	int effectiveProfile = (sourceProfile == 7 || sourceProfile == 8) ? sourceProfile : header->guessed_profile;
-
 	if (sourceProfile != 0 && sourceProfile != header->guessed_profile) {
 		showMessage("DoViBaker: sourceProfile is different than the RPU profile.", env);
 	}
@@ -296,6 +341,7 @@ bool DoViProcessor::intializeFrame(int frame, IScriptEnvironment* env, const uin
 		dovi_rpu_free_header(header);
 		is_fel = false;
 		disable_residual_flag = true;
+		prepareReshapeTables();
 		return successfulCreation;
 	}
 
@@ -363,6 +409,7 @@ bool DoViProcessor::intializeFrame(int frame, IScriptEnvironment* env, const uin
 	if (nlqProof) {
 		fp_linear_deadzone_slope[0] *= 4;
 	}
+	prepareReshapeTables();
 
 	dovi_rpu_free_data_mapping(mapping_data);
 	dovi_rpu_free_header(header);
@@ -394,6 +441,121 @@ uint16_t DoViProcessor::processSample(int cmp, uint16_t bl, uint16_t el, uint16_
 	return h;
 }
 
+void DoViProcessor::processRowY(uint16_t* dst, const uint16_t* bl, const uint16_t* el, int width) const {
+	DoViKernels::get().reshape(dst, bl, el, width, reshapeTables[0]);
+}
+
+void DoViProcessor::processRowU(uint16_t* dst, const uint16_t* blU, const uint16_t* blV, const uint16_t* el, const uint16_t* mmrBlY, int mmrStep, int width) const {
+	processRowChroma(1, dst, blU, blV, el, mmrBlY, mmrStep, width);
+}
+
+void DoViProcessor::processRowV(uint16_t* dst, const uint16_t* blU, const uint16_t* blV, const uint16_t* el, const uint16_t* mmrBlY, int mmrStep, int width) const {
+	processRowChroma(2, dst, blU, blV, el, mmrBlY, mmrStep, width);
+}
+
+void DoViProcessor::processRowChroma(int cmp, uint16_t* dst, const uint16_t* blU, const uint16_t* blV, const uint16_t* el, const uint16_t* mmrBlY, int mmrStep, int width) const {
+	const uint16_t* bl = (cmp == 1) ? blU : blV;
+	if (!mmrMappingUsed[cmp]) {
+		DoViKernels::get().reshape(dst, bl, el, width, reshapeTables[cmp]);
+		return;
+	}
+	for (int w = 0; w < width; w++) {
+		dst[w] = processSample(cmp, bl[w], el[w], mmrBlY[w * mmrStep], blU[w], blV[w]);
+	}
+}
+
+// Linear light of every 16 bit PQ code, limited range expanded to full range and clipped below black.
+// The LMS to RGB matrix cancels large terms for saturated colors, so the EOTF is evaluated in double
+// precision; the float powf of eotfTable16 would be off by several percent in dark saturated areas.
+static const float* lmsEotfTable16(bool limitedRange) {
+	static const std::array<std::vector<float>, 2> luts = [] {
+		const double m1 = DoViPqMath::m1;
+		const double m2 = DoViPqMath::m2;
+		const double c1 = DoViPqMath::c1;
+		const double c2 = DoViPqMath::c2;
+		const double c3 = DoViPqMath::c3;
+		std::array<std::vector<float>, 2> tables;
+		for (int limited = 0; limited < 2; limited++) {
+			tables[limited].resize(65536);
+			for (int code = 0; code < 65536; code++) {
+				const double ep = limited ? std::clamp((code - (16 << 8)) / double((235 - 16) << 8), 0.0, 1.0) : code / 65535.0;
+				const double epower = std::pow(ep, 1 / m2);
+				tables[limited][code] = static_cast<float>(std::pow(std::max(epower - c1, 0.0) / (c2 - c3 * epower), 1 / m1));
+			}
+		}
+		return tables;
+	}();
+	return luts[limitedRange ? 1 : 0].data();
+}
+
+// The RPU carries the RGB to LMS matrix, including the crosstalk of IPTPQc2. Its inverse converts the
+// linearized LMS of IPT input to BT.2020 RGB.
+void DoViProcessor::prepareLmsTables(const DoviVdrDmData* vdr_dm_data) {
+	const int16_t coef[9] = {
+		vdr_dm_data->rgb_to_lms_coef0, vdr_dm_data->rgb_to_lms_coef1, vdr_dm_data->rgb_to_lms_coef2,
+		vdr_dm_data->rgb_to_lms_coef3, vdr_dm_data->rgb_to_lms_coef4, vdr_dm_data->rgb_to_lms_coef5,
+		vdr_dm_data->rgb_to_lms_coef6, vdr_dm_data->rgb_to_lms_coef7, vdr_dm_data->rgb_to_lms_coef8 };
+	double m[9];
+	for (int i = 0; i < 9; i++) {
+		m[i] = coef[i] / double(1 << rgb_to_lms_coef_scale_shifts);
+	}
+	const double det = m[0] * (m[4] * m[8] - m[5] * m[7]) - m[1] * (m[3] * m[8] - m[5] * m[6]) + m[2] * (m[3] * m[7] - m[4] * m[6]);
+	if (std::abs(det) < 1e-6) {
+		// no usable matrix signalled, the output stays black rather than garbage
+		std::fill_n(lmsTables.lmsToRgb, 9, 0.0f);
+	}
+	else {
+		const double inv[9] = {
+			m[4] * m[8] - m[5] * m[7], m[2] * m[7] - m[1] * m[8], m[1] * m[5] - m[2] * m[4],
+			m[5] * m[6] - m[3] * m[8], m[0] * m[8] - m[2] * m[6], m[2] * m[3] - m[0] * m[5],
+			m[3] * m[7] - m[4] * m[6], m[1] * m[6] - m[0] * m[7], m[0] * m[4] - m[1] * m[3] };
+		for (int i = 0; i < 9; i++) {
+			lmsTables.lmsToRgb[i] = static_cast<float>(inv[i] / det);
+		}
+	}
+
+	lmsTables.eotf = lmsEotfTable16(!signal_full_range_flag);
+}
+
+void DoViProcessor::processLmsRow(uint16_t* r, uint16_t* g, uint16_t* b, int width) const {
+	DoViKernels::get().lmsToRgb(r, g, b, width, lmsTables);
+}
+
+// The BL mapping only depends on the BL sample unless MMR is used, the NLQ only on the EL sample.
+// Both are tabulated once per frame, so the per sample work is two lookups and the reconstruction.
+void DoViProcessor::prepareReshapeTables() {
+	const int rounding = 1 << (15 - out_bit_depth);
+	for (int cmp = 0; cmp < 3; cmp++) {
+		mmrMappingUsed[cmp] = cmp > 0 &&
+			std::any_of(mapping_idc[cmp].begin(), mapping_idc[cmp].end(), [](uint8_t idc) { return idc != 0; });
+
+		blMappingLut[cmp].clear();
+		if (!mmrMappingUsed[cmp]) {
+			blMappingLut[cmp].resize(size_t(1) << bl_bit_depth);
+			for (size_t s = 0; s < blMappingLut[cmp].size(); s++) {
+				blMappingLut[cmp][s] = polynompialMapping(cmp, getPivotIndex(cmp, s), s) + rounding;
+			}
+		}
+		elResidualLut[cmp].clear();
+		if (!disable_residual_flag) {
+			elResidualLut[cmp].resize(size_t(1) << el_bit_depth);
+			for (size_t e = 0; e < elResidualLut[cmp].size(); e++) {
+				elResidualLut[cmp][e] = nonLinearInverseQuantization(cmp, e);
+			}
+		}
+
+		DoViReshapeTables& tables = reshapeTables[cmp];
+		tables.blMapping = blMappingLut[cmp].data();
+		tables.elResidual = disable_residual_flag ? nullptr : elResidualLut[cmp].data();
+		tables.blShift = blContainerBitDepth - bl_bit_depth;
+		tables.blMaxIndex = (1 << bl_bit_depth) - 1;
+		tables.elShift = std::max(elContainerBitDepth - el_bit_depth, 0);
+		tables.elMaxIndex = (1 << el_bit_depth) - 1;
+		tables.outShift = outContainerBitDepth - out_bit_depth;
+		tables.outMax = (1 << out_bit_depth) - 1;
+	}
+}
+
 int DoViProcessor::getPivotIndex(int cmp, uint16_t s) const {
 	int pivot_idx = num_pivots_minus1[cmp] - 1;
 	for (int idx = 0; idx < num_pivots_minus1[cmp]; idx++) {
@@ -557,24 +719,29 @@ void DoViProcessor::prepareTrimCoef() {
 	}
 }
 
-void DoViProcessor::processTrim(uint16_t& ro, uint16_t& go, uint16_t& bo, const uint16_t& ri, const uint16_t& gi, const uint16_t& bi) const  {
-	float dr = pq2nits(ri >> (outContainerBitDepth - out_bit_depth));
-	float dg = pq2nits(gi >> (outContainerBitDepth - out_bit_depth));
-	float db = pq2nits(bi >> (outContainerBitDepth - out_bit_depth));
+float DoViProcessor::trimToneCurve(uint16_t pq) const {
+	float d = pq2nits(pq);
+	return (trim.ccc[0] + d * trim.ccc[1]) / (1 + d * trim.ccc[2]);
+}
+
+float DoViProcessor::trimSlopeOffsetPower(float e) const {
+	float y3 = targetMaxNits;
+	return powf((std::clamp(((e / y3) * trim.goP[0]) + trim.goP[1], 0.0f, 1.0f)), trim.goP[2]) * y3;
+}
 
-	float er = (trim.ccc[0] + dr * trim.ccc[1]) / (1 + dr * trim.ccc[2]);
-	float eg = (trim.ccc[0] + dg * trim.ccc[1]) / (1 + dg * trim.ccc[2]);
-	float eb = (trim.ccc[0] + db * trim.ccc[1]) / (1 + db * trim.ccc[2]);
+void DoViProcessor::processTrim(uint16_t& ro, uint16_t& go, uint16_t& bo, const uint16_t& ri, const uint16_t& gi, const uint16_t& bi) const  {
+	float er = trimToneCurve(ri >> (outContainerBitDepth - out_bit_depth));
+	float eg = trimToneCurve(gi >> (outContainerBitDepth - out_bit_depth));
+	float eb = trimToneCurve(bi >> (outContainerBitDepth - out_bit_depth));
 
 	if (trimInfoMissing) {
 		ro = nits2pq(er) << (outContainerBitDepth - out_bit_depth);
 		go = nits2pq(eg) << (outContainerBitDepth - out_bit_depth);
 		bo = nits2pq(eb) << (outContainerBitDepth - out_bit_depth);
 	}	else {
-		float y3 = targetMaxNits;
-		float fr = powf((std::clamp(((er / y3) * trim.goP[0]) + trim.goP[1], 0.0f, 1.0f)), trim.goP[2]) * y3;
-		float fg = powf((std::clamp(((eg / y3) * trim.goP[0]) + trim.goP[1], 0.0f, 1.0f)), trim.goP[2]) * y3;
-		float fb = powf((std::clamp(((eb / y3) * trim.goP[0]) + trim.goP[1], 0.0f, 1.0f)), trim.goP[2]) * y3;
+		float fr = trimSlopeOffsetPower(er);
+		float fg = trimSlopeOffsetPower(eg);
+		float fb = trimSlopeOffsetPower(eb);
 
 		float Y = 0.22897f * fr + 0.69174f * fg + 0.07929f * fb;
 		float gr = fr * powf((1 + trim.cS[0]) * fr / Y, trim.cS[1]);
@@ -586,3 +753,53 @@ void DoViProcessor::processTrim(uint16_t& ro, uint16_t& go, uint16_t& bo, const
 		bo = nits2pq(gb) << (outContainerBitDepth - out_bit_depth);
 	}
 }
+
+void DoViProcessor::processTrimRow(uint16_t* r, uint16_t* g, uint16_t* b, int width) const {
+	if (trimInfoMissing) {
+		const int shift = outContainerBitDepth - out_bit_depth;
+		for (int w = 0; w < width; w++) {
+			r[w] = trimDirectLut[r[w] >> shift];
+			g[w] = trimDirectLut[g[w] >> shift];
+			b[w] = trimDirectLut[b[w] >> shift];
+		}
+		return;
+	}
+	DoViKernels::get().trimSaturation(r, g, b, width, trimTables);
+}
+
+// Everything in front of the saturation step only depends on the sample of a single channel
+// and is tabulated. The coefficients follow L1 and L2, so the tables are kept within a scene.
+void DoViProcessor::prepareTrimTables() {
+	std::array<float, 11> key = { trim.ccc[0], trim.ccc[1], trim.ccc[2], 0, 0, 0, 0, 0, targetMaxNits,
+		static_cast<float>(out_bit_depth), trimInfoMissing ? 1.0f : 0.0f };
+	if (!trimInfoMissing) {
+		std::copy(trim.goP, trim.goP + 3, key.begin() + 3);
+		std::copy(trim.cS, trim.cS + 2, key.begin() + 6);
+	}
+	if (key == trimTablesKey && !(trimToneLut.empty() && trimDirectLut.empty()))
+		return;
+	trimTablesKey = key;
+
+	const int shift = outContainerBitDepth - out_bit_depth;
+	const size_t size = size_t(1) << out_bit_depth;
+	trimToneLut.clear();
+	trimDirectLut.clear();
+	if (trimInfoMissing) {
+		trimDirectLut.resize(size);
+		for (size_t pq = 0; pq < size; pq++) {
+			trimDirectLut[pq] = nits2pq(trimToneCurve(pq)) << shift;
+		}
+		return;
+	}
+
+	trimToneLut.resize(size);
+	for (size_t pq = 0; pq < size; pq++) {
+		trimToneLut[pq] = trimSlopeOffsetPower(trimToneCurve(pq));
+	}
+	trimTables.tone = trimToneLut.data();
+	trimTables.pqThresholds = DoViPqMath::nitsToPq12Thresholds();
+	trimTables.inShift = shift;
+	trimTables.outShift = shift;
+	trimTables.chromaWeight = 1 + trim.cS[0];
+	trimTables.saturationGain = trim.cS[1];
+}
@@ -0,0 +1,240 @@
+#include "DoViRpuAnalyzer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <thread>
+
+namespace {
+	inline void widen(uint16_t range[2], uint16_t value)
+	{
+		range[0] = std::min(range[0], value);
+		range[1] = std::max(range[1], value);
+	}
+
+	inline void widen(uint16_t range[2], const uint16_t other[2])
+	{
+		range[0] = std::min(range[0], other[0]);
+		range[1] = std::max(range[1], other[1]);
+	}
+}
+
+DoViRpuSummary DoViRpuAnalyzer::analyze(const DoviRpuOpaqueList* rpus, int threads)
+{
+	DoViRpuSummary summary;
+	if (!rpus) {
+		summary.error = "RPU list not given";
+		return summary;
+	}
+	if (rpus->error) {
+		summary.error = rpus->error;
+		return summary;
+	}
+
+	const size_t frames = rpus->len;
+	if (threads <= 0)
+		threads = static_cast<int>(std::thread::hardware_concurrency());
+	// below a few thousand frames the thread startup costs more than it saves
+	threads = static_cast<int>(std::clamp<size_t>(frames / 2048, 1, std::max(threads, 1)));
+
+	std::vector<DoViRpuSummary> partials(threads);
+	std::vector<std::thread> workers;
+	const size_t chunk = (frames + threads - 1) / threads;
+	for (int t = 1; t < threads; t++) {
+		const size_t first = std::min(frames, t * chunk);
+		const size_t last = std::min(frames, first + chunk);
+		workers.emplace_back(analyzeRange, rpus, first, last, std::ref(partials[t]));
+	}
+	analyzeRange(rpus, 0, std::min(frames, chunk), partials[0]);
+	for (auto& worker : workers)
+		worker.join();
+
+	summary = std::move(partials[0]);
+	for (int t = 1; t < threads; t++)
+		merge(summary, partials[t]);
+
+	if (summary.frames && (summary.sceneCuts.empty() || summary.sceneCuts.front() != 0))
+		summary.sceneCuts.insert(summary.sceneCuts.begin(), 0);
+	if (!summary.hasL5) {
+		std::fill_n(summary.l5Offsets, 4, 0);
+	}
+	return summary;
+}
+
+void DoViRpuAnalyzer::analyzeRange(const DoviRpuOpaqueList* rpus, size_t first, size_t last, DoViRpuSummary& summary)
+{
+	for (size_t frame = first; frame < last; frame++) {
+		const DoviRpuOpaque* rpu = rpus->list[frame];
+		const DoviRpuDataHeader* header = dovi_rpu_get_header(rpu);
+		if (!header) {
+			if (summary.error.empty()) {
+				const char* error = dovi_rpu_get_error(rpu);
+				summary.error = std::string(error ? error : "RPU header cannot be parsed") + " (frame " + std::to_string(frame) + ")";
+			}
+			continue;
+		}
+		const std::string elType = header->el_type ? header->el_type : "";
+		if (!summary.frames++) {
+			summary.profile = header->guessed_profile;
+			summary.elType = elType;
+		}
+		else {
+			summary.profileVaries |= header->guessed_profile != summary.profile;
+			summary.elTypeVaries |= elType != summary.elType;
+		}
+		std::string el_type = elType;
+		std::transform(el_type.begin(), el_type.end(), el_type.begin(),
+			[](unsigned char c) { return toupper(c); });
+		if (header->guessed_profile == 7 && el_type == "FEL" && !header->disable_residual_flag)
+			summary.residualFrames++;
+
+		const DoviRpuDataMapping* mapping_data = dovi_rpu_get_data_mapping(rpu);
+		if (mapping_data) {
+			bool identity = true;
+			bool mmr = false;
+			for (int cmp = 0; cmp < 3; cmp++) {
+				const DoviReshapingCurve& curve = mapping_data->curves[cmp];
+				mmr |= curve.mmr != nullptr;
+				identity &= isIdentityCurve(curve, header->coefficient_log2_denom, header->bl_bit_depth_minus8 + 8);
+			}
+			if (identity)
+				summary.identityMappingFrames++;
+			else if (mmr)
+				summary.mmrMappingFrames++;
+			else
+				summary.polyMappingFrames++;
+			dovi_rpu_free_data_mapping(mapping_data);
+		}
+
+		if (header->vdr_dm_metadata_present_flag) {
+			const DoviVdrDmData* vdr_dm_data = dovi_rpu_get_vdr_dm_data(rpu);
+			if (vdr_dm_data) {
+				if (vdr_dm_data->scene_refresh_flag)
+					summary.sceneCuts.push_back(static_cast<int>(frame));
+
+				const DoviDmData& dm = vdr_dm_data->dm_data;
+				if (dm.level1) {
+					summary.hasL1 = true;
+					widen(summary.l1MinPq, dm.level1->min_pq);
+					widen(summary.l1MaxPq, dm.level1->max_pq);
+					widen(summary.l1AvgPq, dm.level1->avg_pq);
+				}
+				for (size_t i = 0; i < dm.level2.len; i++) {
+					const uint16_t target = dm.level2.list[i]->target_max_pq;
+					if (std::find(summary.l2TargetPqs.begin(), summary.l2TargetPqs.end(), target) == summary.l2TargetPqs.end())
+						summary.l2TargetPqs.push_back(target);
+				}
+				if (dm.level5) {
+					const uint16_t offsets[4] = {
+						dm.level5->active_area_left_offset,
+						dm.level5->active_area_right_offset,
+						dm.level5->active_area_top_offset,
+						dm.level5->active_area_bottom_offset };
+					if (!summary.hasL5) {
+						std::copy_n(offsets, 4, summary.l5Offsets);
+						summary.hasL5 = true;
+					}
+					else {
+						for (int i = 0; i < 4; i++) {
+							summary.l5Varies |= offsets[i] != summary.l5Offsets[i];
+							summary.l5Offsets[i] = std::min(summary.l5Offsets[i], offsets[i]);
+						}
+					}
+				}
+				if (dm.level6) {
+					summary.hasL6 = true;
+					widen(summary.l6MaxCll, dm.level6->max_content_light_level);
+					widen(summary.l6MaxFall, dm.level6->max_frame_average_light_level);
+					widen(summary.l6MasterMaxLuminance, dm.level6->max_display_mastering_luminance);
+					widen(summary.l6MasterMinLuminance, dm.level6->min_display_mastering_luminance);
+				}
+				dovi_rpu_free_vdr_dm_data(vdr_dm_data);
+			}
+		}
+		dovi_rpu_free_header(header);
+	}
+	std::sort(summary.l2TargetPqs.begin(), summary.l2TargetPqs.end());
+}
+
+void DoViRpuAnalyzer::merge(DoViRpuSummary& into, const DoViRpuSummary& from)
+{
+	if (into.error.empty())
+		into.error = from.error;
+	if (!into.frames) {
+		into.profile = from.profile;
+		into.elType = from.elType;
+		into.profileVaries = from.profileVaries;
+		into.elTypeVaries = from.elTypeVaries;
+	}
+	else if (from.frames) {
+		into.profileVaries |= from.profileVaries || from.profile != into.profile;
+		into.elTypeVaries |= from.elTypeVaries || from.elType != into.elType;
+	}
+	into.frames += from.frames;
+	into.residualFrames += from.residualFrames;
+	into.identityMappingFrames += from.identityMappingFrames;
+	into.polyMappingFrames += from.polyMappingFrames;
+	into.mmrMappingFrames += from.mmrMappingFrames;
+
+	// ranges are merged in frame order, so the scene cuts stay sorted
+	into.sceneCuts.insert(into.sceneCuts.end(), from.sceneCuts.begin(), from.sceneCuts.end());
+
+	if (from.hasL1) {
+		into.hasL1 = true;
+		widen(into.l1MinPq, from.l1MinPq);
+		widen(into.l1MaxPq, from.l1MaxPq);
+		widen(into.l1AvgPq, from.l1AvgPq);
+	}
+
+	if (from.hasL6) {
+		into.hasL6 = true;
+		widen(into.l6MaxCll, from.l6MaxCll);
+		widen(into.l6MaxFall, from.l6MaxFall);
+		widen(into.l6MasterMaxLuminance, from.l6MasterMaxLuminance);
+		widen(into.l6MasterMinLuminance, from.l6MasterMinLuminance);
+	}
+
+	for (uint16_t target : from.l2TargetPqs) {
+		if (std::find(into.l2TargetPqs.begin(), into.l2TargetPqs.end(), target) == into.l2TargetPqs.end())
+			into.l2TargetPqs.push_back(target);
+	}
+	std::sort(into.l2TargetPqs.begin(), into.l2TargetPqs.end());
+
+	if (from.hasL5) {
+		if (!into.hasL5) {
+			std::copy_n(from.l5Offsets, 4, into.l5Offsets);
+			into.l5Varies = from.l5Varies;
+			into.hasL5 = true;
+		}
+		else {
+			into.l5Varies |= from.l5Varies;
+			for (int i = 0; i < 4; i++) {
+				into.l5Varies |= from.l5Offsets[i] != into.l5Offsets[i];
+				into.l5Offsets[i] = std::min(into.l5Offsets[i], from.l5Offsets[i]);
+			}
+		}
+	}
+}
+
+bool DoViRpuAnalyzer::isIdentityCurve(const DoviReshapingCurve& curve, uint64_t coeffLog2Denom, uint8_t blBitDepth)
+{
+	if (!curve.polynomial || curve.pivots.len < 2)
+		return false;
+
+	uint32_t lastPivot = 0;
+	for (size_t i = 0; i < curve.pivots.len; i++)
+		lastPivot += curve.pivots.data[i];
+	if (curve.pivots.data[0] != 0 || lastPivot != (1u << blBitDepth) - 1)
+		return false;
+
+	const DoviPolynomialCurve* poly = curve.polynomial;
+	for (size_t pivot_idx = 0; pivot_idx < poly->poly_order_minus1.len; pivot_idx++) {
+		const int order = static_cast<int>(poly->poly_order_minus1.data[pivot_idx]) + 1;
+		for (int coeff = 0; coeff <= order; coeff++) {
+			const int64_t fp_coef = (poly->poly_coef_int.list[pivot_idx]->data[coeff] << coeffLog2Denom) + poly->poly_coef.list[pivot_idx]->data[coeff];
+			const int64_t expected = coeff == 1 ? (int64_t(1) << coeffLog2Denom) : 0;
+			if (fp_coef != expected)
+				return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,114 @@
+#include "DoViRpuWriter.h"
+
+namespace {
+	// Annex B start code preceding every NAL unit in an RPU.bin file
+	constexpr uint8_t startCode[4] = { 0, 0, 0, 1 };
+	// frames held back while waiting for an earlier one, beyond that the earlier one is given up on
+	constexpr size_t maxPending = 1024;
+}
+
+DoViRpuWriter::~DoViRpuWriter()
+{
+	if (!file.is_open())
+		return;
+	std::lock_guard<std::mutex> lock(writeMutex);
+	file.close();
+	// a file with gaps or missing frames would not line up with the video, it is removed instead
+	if (abandoned || nextFrame != numFrames) {
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+	}
+}
+
+bool DoViRpuWriter::convert(const DoviRpuOpaqueList* rpus, int frame, const uint8_t* rpubuf, size_t rpusize,
+	uint8_t mode, bool removeMapping, std::vector<uint8_t>& nalu, std::string& error)
+{
+	DoviRpuOpaque* rpu = nullptr;
+	if (rpus) {
+		// the list is shared by all processors, so convert a re-parsed copy instead of the entry itself
+		const DoviData* raw = dovi_write_rpu(rpus->list[frame]);
+		if (!raw) {
+			const char* rpuError = dovi_rpu_get_error(rpus->list[frame]);
+			error = rpuError ? rpuError : "RPU cannot be written";
+			return false;
+		}
+		rpu = dovi_parse_rpu(raw->data, raw->len);
+		dovi_data_free(raw);
+	}
+	else if (rpubuf) {
+		rpu = dovi_parse_unspec62_nalu(rpubuf, rpusize);
+	}
+	else {
+		error = "RPU not given";
+		return false;
+	}
+
+	bool success = true;
+	if (mode && dovi_convert_rpu_with_mode(rpu, mode) < 0)
+		success = false;
+	if (success && removeMapping && dovi_rpu_remove_mapping(rpu) < 0)
+		success = false;
+	if (success) {
+		const DoviData* out = dovi_write_unspec62_nalu(rpu);
+		if (out) {
+			nalu.assign(out->data, out->data + out->len);
+			dovi_data_free(out);
+		}
+		else {
+			success = false;
+		}
+	}
+	if (!success) {
+		const char* rpuError = dovi_rpu_get_error(rpu);
+		error = rpuError ? rpuError : "RPU conversion failed";
+	}
+	dovi_rpu_free(rpu);
+	return success;
+}
+
+bool DoViRpuWriter::open(const char* path, int numFrames, std::string& error)
+{
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		error = std::string("Cannot open RPU output file ") + path;
+		return false;
+	}
+	this->path = path;
+	this->numFrames = numFrames;
+	return true;
+}
+
+void DoViRpuWriter::write(int frame, std::vector<uint8_t>&& nalu)
+{
+	std::lock_guard<std::mutex> lock(writeMutex);
+	if (abandoned || frame < nextFrame)
+		return; // frame requested again, already written
+	pending.emplace(frame, std::move(nalu));
+	flush();
+	if (pending.size() > maxPending)
+		abandon();
+}
+
+void DoViRpuWriter::fail(int frame)
+{
+	std::lock_guard<std::mutex> lock(writeMutex);
+	if (frame >= nextFrame)
+		abandon();
+}
+
+void DoViRpuWriter::abandon()
+{
+	abandoned = true;
+	pending.clear();
+}
+
+void DoViRpuWriter::flush()
+{
+	for (auto it = pending.begin(); it != pending.end() && it->first == nextFrame; it = pending.erase(it)) {
+		file.write(reinterpret_cast<const char*>(startCode), sizeof(startCode));
+		file.write(reinterpret_cast<const char*>(it->second.data()), it->second.size());
+		nextFrame++;
+	}
+	if (nextFrame == numFrames)
+		file.flush();
+}
@@ -0,0 +1,526 @@
+#include <algorithm>
+#include <cfloat>
+
+#include "../DoViKernelsImpl.h"
+
+#ifdef DOVI_KERNELS_X86
+#include <immintrin.h>
+
+namespace {
+	// 8 samples widened to 32 bit, so the taps can be applied without overflow
+	inline __m256i load8(const uint16_t* p)
+	{
+		return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+	}
+
+	inline __m256i mul(__m256i x, int c)
+	{
+		return _mm256_mullo_epi32(x, _mm256_set1_epi32(c));
+	}
+
+	// packs two vectors of 8 results to 16 samples in order, saturating to [0, 0xFFFF] like Clip3
+	inline void store16(uint16_t* p, __m256i lo, __m256i hi)
+	{
+		const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), packed);
+	}
+
+	// interleaves 8 even and 8 odd results to 16 consecutive samples
+	inline void storeInterleaved16(uint16_t* p, __m256i even, __m256i odd)
+	{
+		const __m256i packed = _mm256_packus_epi32(_mm256_unpacklo_epi32(even, odd), _mm256_unpackhi_epi32(even, odd));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), packed);
+	}
+
+	// taps of DoViProcessor::upsampleLumaEven / upsampleLumaOdd on y[n - 2] .. y[n + 2]
+	inline __m256i lumaEven(__m256i ym2, __m256i ym1, __m256i y0, __m256i yp1)
+	{
+		__m256i sum = _mm256_add_epi32(mul(ym2, -3), mul(ym1, 29));
+		sum = _mm256_add_epi32(sum, _mm256_add_epi32(mul(y0, 111), mul(yp1, -9)));
+		return _mm256_srai_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(64)), 7);
+	}
+
+	inline __m256i lumaOdd(__m256i ym1, __m256i y0, __m256i yp1, __m256i yp2)
+	{
+		__m256i sum = _mm256_add_epi32(mul(ym1, -9), mul(y0, 111));
+		sum = _mm256_add_epi32(sum, _mm256_add_epi32(mul(yp1, 29), mul(yp2, -3)));
+		return _mm256_srai_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(64)), 7);
+	}
+
+	// taps of DoViProcessor::upsampleChromaOdd on y[n - 1] .. y[n + 2]
+	inline __m256i chromaOdd(__m256i ym1, __m256i y0, __m256i yp1, __m256i yp2)
+	{
+		const __m256i sum = _mm256_sub_epi32(mul(_mm256_add_epi32(y0, yp1), 2355), mul(_mm256_add_epi32(ym1, yp2), 307));
+		return _mm256_srai_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(2048)), 12);
+	}
+
+	// one output channel of the YCbCr to RGB matrix, before narrowing
+	inline __m256i matrixRow(__m256i yf, __m256i uf, __m256i vf, const int16_t* coef)
+	{
+		__m256i sum = _mm256_add_epi32(mul(yf, coef[0]), mul(uf, coef[1]));
+		sum = _mm256_add_epi32(sum, mul(vf, coef[2]));
+		return _mm256_srai_epi32(sum, 13);
+	}
+
+	void upsampleLumaVert_avx2(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			__m256i res[2];
+			for (int half = 0; half < 2; half++) {
+				const int x = w + 8 * half;
+				res[half] = odd
+					? lumaOdd(load8(src[1] + x), load8(src[2] + x), load8(src[3] + x), load8(src[4] + x))
+					: lumaEven(load8(src[0] + x), load8(src[1] + x), load8(src[2] + x), load8(src[3] + x));
+			}
+			store16(dst + w, res[0], res[1]);
+		}
+		upsampleLumaVertRange_c(dst, src, w, width, odd);
+	}
+
+	void upsampleChromaVert_avx2(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		if (!odd) {
+			upsampleChromaVertRange_c(dst, src, 0, width, odd);
+			return;
+		}
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			__m256i res[2];
+			for (int half = 0; half < 2; half++) {
+				const int x = w + 8 * half;
+				res[half] = chromaOdd(load8(src[0] + x), load8(src[1] + x), load8(src[2] + x), load8(src[3] + x));
+			}
+			store16(dst + w, res[0], res[1]);
+		}
+		upsampleChromaVertRange_c(dst, src, w, width, odd);
+	}
+
+	void upsampleLumaHorz_avx2(uint16_t* dst, const uint16_t* src, int width)
+	{
+		// the vector loop covers the columns that need no clamping
+		int w = 2;
+		upsampleLumaHorzRange_c(dst, src, width, 0, std::min(w, width));
+		for (; w + 8 <= width - 2; w += 8) {
+			const __m256i ym2 = load8(src + w - 2);
+			const __m256i ym1 = load8(src + w - 1);
+			const __m256i y0 = load8(src + w);
+			const __m256i yp1 = load8(src + w + 1);
+			const __m256i yp2 = load8(src + w + 2);
+			storeInterleaved16(dst + 2 * w, lumaEven(ym2, ym1, y0, yp1), lumaOdd(ym1, y0, yp1, yp2));
+		}
+		upsampleLumaHorzRange_c(dst, src, width, std::min(w, width), width);
+	}
+
+	void upsampleChromaHorz_avx2(uint16_t* dst, const uint16_t* src, int width)
+	{
+		int w = 1;
+		upsampleChromaHorzRange_c(dst, src, width, 0, std::min(w, width));
+		for (; w + 8 <= width - 2; w += 8) {
+			const __m256i ym1 = load8(src + w - 1);
+			const __m256i y0 = load8(src + w);
+			const __m256i yp1 = load8(src + w + 1);
+			const __m256i yp2 = load8(src + w + 2);
+			storeInterleaved16(dst + 2 * w, y0, chromaOdd(ym1, y0, yp1, yp2));
+		}
+		upsampleChromaHorzRange_c(dst, src, width, std::min(w, width), width);
+	}
+
+	inline __m256i loadWords(const uint16_t* p)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	}
+
+	// (a + b) >> 1, the average instruction rounds up
+	inline __m256i avgFloor(__m256i a, __m256i b)
+	{
+		return _mm256_sub_epi16(_mm256_avg_epu16(a, b), _mm256_and_si256(_mm256_xor_si256(a, b), _mm256_set1_epi16(1)));
+	}
+
+	// (a + 3 * b + 2) >> 2 without widening, equal to (((a + b) >> 1) + b + 1) >> 1
+	inline __m256i quarterBlend(__m256i a, __m256i b)
+	{
+		return _mm256_avg_epu16(b, avgFloor(a, b));
+	}
+
+	// interleaves 16 even and 16 odd samples to 32 consecutive samples
+	inline void storeInterleavedWords(uint16_t* p, __m256i even, __m256i odd)
+	{
+		const __m256i lo = _mm256_unpacklo_epi16(even, odd);
+		const __m256i hi = _mm256_unpackhi_epi16(even, odd);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+
+	void upsampleLumaVertBilinear_avx2(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		const uint16_t* outer = odd ? src[3] : src[1];
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), quarterBlend(loadWords(outer + w), loadWords(src[2] + w)));
+		}
+		upsampleLumaVertBilinearRange_c(dst, src, w, width, odd);
+	}
+
+	void upsampleChromaVertBilinear_avx2(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		if (!odd) {
+			upsampleChromaVertBilinearRange_c(dst, src, 0, width, odd);
+			return;
+		}
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), _mm256_avg_epu16(loadWords(src[1] + w), loadWords(src[2] + w)));
+		}
+		upsampleChromaVertBilinearRange_c(dst, src, w, width, odd);
+	}
+
+	void upsampleLumaHorzBilinear_avx2(uint16_t* dst, const uint16_t* src, int width)
+	{
+		int w = 1;
+		upsampleLumaHorzBilinearRange_c(dst, src, width, 0, std::min(w, width));
+		for (; w + 16 <= width - 1; w += 16) {
+			const __m256i y0 = loadWords(src + w);
+			storeInterleavedWords(dst + 2 * w, quarterBlend(loadWords(src + w - 1), y0), quarterBlend(loadWords(src + w + 1), y0));
+		}
+		upsampleLumaHorzBilinearRange_c(dst, src, width, std::min(w, width), width);
+	}
+
+	void upsampleChromaHorzBilinear_avx2(uint16_t* dst, const uint16_t* src, int width)
+	{
+		int w = 0;
+		for (; w + 16 <= width - 1; w += 16) {
+			const __m256i y0 = loadWords(src + w);
+			storeInterleavedWords(dst + 2 * w, y0, _mm256_avg_epu16(y0, loadWords(src + w + 1)));
+		}
+		upsampleChromaHorzBilinearRange_c(dst, src, width, w, width);
+	}
+
+	void ycc2rgb_avx2(uint16_t* r, uint16_t* g, uint16_t* b, const uint16_t* y, const uint16_t* u, const uint16_t* v,
+		int width, const int16_t* coef, const uint32_t* offset)
+	{
+		const __m256i offY = _mm256_set1_epi32(static_cast<int>(offset[0]));
+		const __m256i offU = _mm256_set1_epi32(static_cast<int>(offset[1]));
+		const __m256i offV = _mm256_set1_epi32(static_cast<int>(offset[2]));
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			__m256i res[3][2];
+			for (int half = 0; half < 2; half++) {
+				const int x = w + 8 * half;
+				const __m256i yf = _mm256_sub_epi32(load8(y + x), offY);
+				const __m256i uf = _mm256_sub_epi32(load8(u + x), offU);
+				const __m256i vf = _mm256_sub_epi32(load8(v + x), offV);
+				for (int c = 0; c < 3; c++)
+					res[c][half] = matrixRow(yf, uf, vf, coef + 3 * c);
+			}
+			store16(r + w, res[0][0], res[0][1]);
+			store16(g + w, res[1][0], res[1][1]);
+			store16(b + w, res[2][0], res[2][1]);
+		}
+		ycc2rgbRange_c(r, g, b, y, u, v, w, width, coef, offset);
+	}
+
+	// looks up 8 samples shifted to table indices, clamped to the table size
+	inline __m256i lookup8(const int32_t* table, const uint16_t* p, __m128i shift, __m256i maxIndex)
+	{
+		const __m256i idx = _mm256_min_epi32(_mm256_srl_epi32(load8(p), shift), maxIndex);
+		return _mm256_i32gather_epi32(reinterpret_cast<const int*>(table), idx, 4);
+	}
+
+	void reshape_avx2(uint16_t* dst, const uint16_t* bl, const uint16_t* el, int width, const DoViReshapeTables& tables)
+	{
+		const __m128i blShift = _mm_cvtsi32_si128(tables.blShift);
+		const __m128i elShift = _mm_cvtsi32_si128(tables.elShift);
+		const __m128i outShift = _mm_cvtsi32_si128(tables.outShift);
+		const __m256i blMaxIndex = _mm256_set1_epi32(tables.blMaxIndex);
+		const __m256i elMaxIndex = _mm256_set1_epi32(tables.elMaxIndex);
+		const __m256i outMax = _mm256_set1_epi32(tables.outMax);
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			__m256i res[2];
+			for (int half = 0; half < 2; half++) {
+				const int x = w + 8 * half;
+				__m256i h = lookup8(tables.blMapping, bl + x, blShift, blMaxIndex);
+				if (tables.elResidual)
+					h = _mm256_add_epi32(h, lookup8(tables.elResidual, el + x, elShift, elMaxIndex));
+				h = _mm256_sra_epi32(h, outShift);
+				h = _mm256_min_epi32(_mm256_max_epi32(h, _mm256_setzero_si256()), outMax);
+				res[half] = _mm256_sll_epi32(h, outShift);
+			}
+			store16(dst + w, res[0], res[1]);
+		}
+		reshapeRange_c(dst, bl, el, w, width, tables);
+	}
+
+	// same operations as log2Approx / exp2Approx of the portable kernels
+	inline __m256 log2Approx(__m256 x)
+	{
+		const __m256i bits = _mm256_castps_si256(x);
+		__m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+		__m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x7FFFFF)), _mm256_set1_epi32(0x3F800000)));
+		const __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+		m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+		e = _mm256_blendv_ps(e, _mm256_add_ps(e, _mm256_set1_ps(1.0f)), big);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+		const __m256 t2 = _mm256_mul_ps(t, t);
+		__m256 p = _mm256_fmadd_ps(_mm256_set1_ps(kLog2Coef[4]), t2, _mm256_set1_ps(kLog2Coef[3]));
+		p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(kLog2Coef[2]));
+		p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(kLog2Coef[1]));
+		p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(kLog2Coef[0]));
+		return _mm256_fmadd_ps(p, t, e);
+	}
+
+	inline __m256 exp2Approx(__m256 y)
+	{
+		y = _mm256_min_ps(_mm256_max_ps(y, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(127.0f));
+		const __m256 n = _mm256_round_ps(y, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		const __m256 f = _mm256_sub_ps(y, n);
+		__m256 p = _mm256_set1_ps(kExp2Coef[7]);
+		for (int i = 6; i >= 0; i--)
+			p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(kExp2Coef[i]));
+		const __m256i sbits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+		return _mm256_mul_ps(p, _mm256_castsi256_ps(sbits));
+	}
+
+	// same as powApprox of the portable kernels
+	inline __m256 powApprox(__m256 x, float p)
+	{
+		const __m256 positive = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ);
+		x = _mm256_max_ps(x, _mm256_set1_ps(FLT_MIN));
+		return _mm256_and_ps(exp2Approx(_mm256_mul_ps(_mm256_set1_ps(p), log2Approx(x))), positive);
+	}
+
+	inline __m256i nitsToPq(const float* thresholds, __m256 nits)
+	{
+		__m256i idx = _mm256_setzero_si256();
+		for (int step = 2048; step > 0; step >>= 1) {
+			const __m256i stepV = _mm256_set1_epi32(step);
+			const __m256 th = _mm256_i32gather_ps(thresholds, _mm256_add_epi32(idx, stepV), 4);
+			const __m256i le = _mm256_castps_si256(_mm256_cmp_ps(th, nits, _CMP_LE_OQ));
+			idx = _mm256_add_epi32(idx, _mm256_and_si256(le, stepV));
+		}
+		return idx;
+	}
+
+	inline __m256i trimChannel(__m256 f, __m256 y, const DoViTrimTables& tables, __m128i outShift)
+	{
+		const __m256 x = _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(tables.chromaWeight), f), y);
+		const __m256 gain = exp2Approx(_mm256_mul_ps(_mm256_set1_ps(tables.saturationGain), log2Approx(x)));
+		const __m256i code = _mm256_sll_epi32(nitsToPq(tables.pqThresholds, _mm256_mul_ps(f, gain)), outShift);
+		return _mm256_and_si256(code, _mm256_set1_epi32(0xFFFF));
+	}
+
+	void trimSaturation_avx2(uint16_t* r, uint16_t* g, uint16_t* b, int width, const DoViTrimTables& tables)
+	{
+		const __m128i inShift = _mm_cvtsi32_si128(tables.inShift);
+		const __m128i outShift = _mm_cvtsi32_si128(tables.outShift);
+		uint16_t* rgb[3] = { r, g, b };
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			__m256i res[3][2];
+			for (int half = 0; half < 2; half++) {
+				const int x = w + 8 * half;
+				__m256 f[3];
+				for (int c = 0; c < 3; c++)
+					f[c] = _mm256_i32gather_ps(tables.tone, _mm256_srl_epi32(load8(rgb[c] + x), inShift), 4);
+				const __m256 y = _mm256_fmadd_ps(_mm256_set1_ps(kTrimLumaWeight[2]), f[2],
+					_mm256_fmadd_ps(_mm256_set1_ps(kTrimLumaWeight[1]), f[1], _mm256_mul_ps(_mm256_set1_ps(kTrimLumaWeight[0]), f[0])));
+				for (int c = 0; c < 3; c++)
+					res[c][half] = trimChannel(f[c], y, tables, outShift);
+			}
+			for (int c = 0; c < 3; c++)
+				store16(rgb[c] + w, res[c][0], res[c][1]);
+		}
+		trimSaturationRange_c(r, g, b, w, width, tables);
+	}
+
+	void replicate2x_avx2(uint16_t* dst, const uint16_t* src, int width)
+	{
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + w));
+			// the unpacks work per 128 bit lane, the permutes bring the lanes back in order
+			const __m256i lo = _mm256_unpacklo_epi16(x, x);
+			const __m256i hi = _mm256_unpackhi_epi16(x, x);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * w), _mm256_permute2x128_si256(lo, hi, 0x20));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * w + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+		}
+		replicate2xRange_c(dst, src, w, width);
+	}
+
+	void lookupFloat_avx2(float* dst, const uint16_t* src, int width, const float* table)
+	{
+		int w = 0;
+		for (; w + 8 <= width; w += 8) {
+			_mm256_storeu_ps(dst + w, _mm256_i32gather_ps(table, load8(src + w), 4));
+		}
+		lookupFloatRange_c(dst, src, w, width, table);
+	}
+
+	void lookup16_avx2(uint16_t* dst, const uint16_t* src, int width, const uint16_t* table)
+	{
+		// 32 bit gathers at 2 byte steps, the upper half belongs to the next entry or the padding
+		const int* base = reinterpret_cast<const int*>(table);
+		const __m256i low = _mm256_set1_epi32(0xFFFF);
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			const __m256i lo = _mm256_and_si256(_mm256_i32gather_epi32(base, load8(src + w), 2), low);
+			const __m256i hi = _mm256_and_si256(_mm256_i32gather_epi32(base, load8(src + w + 8), 2), low);
+			store16(dst + w, lo, hi);
+		}
+		lookup16Range_c(dst, src, w, width, table);
+	}
+
+	void pqEotf_avx2(float* dst, const float* src, int width)
+	{
+		int w = 0;
+		for (; w + 8 <= width; w += 8) {
+			const __m256 epower = powApprox(_mm256_loadu_ps(src + w), 1 / DoViPqMath::m2);
+			const __m256 num = _mm256_max_ps(_mm256_sub_ps(epower, _mm256_set1_ps(DoViPqMath::c1)), _mm256_setzero_ps());
+			const __m256 denom = _mm256_fnmadd_ps(_mm256_set1_ps(DoViPqMath::c3), epower, _mm256_set1_ps(DoViPqMath::c2));
+			_mm256_storeu_ps(dst + w, powApprox(_mm256_div_ps(num, denom), 1 / DoViPqMath::m1));
+		}
+		pqEotfRange_c(dst, src, w, width);
+	}
+
+	inline __m256 pqInverseEotf(__m256 y)
+	{
+		const __m256 epower = powApprox(y, DoViPqMath::m1);
+		const __m256 num = _mm256_fmadd_ps(_mm256_set1_ps(DoViPqMath::c2), epower, _mm256_set1_ps(DoViPqMath::c1));
+		const __m256 denom = _mm256_fmadd_ps(_mm256_set1_ps(DoViPqMath::c3), epower, _mm256_set1_ps(1.0f));
+		return powApprox(_mm256_div_ps(num, denom), DoViPqMath::m2);
+	}
+
+	void pqInverseEotf_avx2(float* dst, const float* src, int width)
+	{
+		int w = 0;
+		for (; w + 8 <= width; w += 8) {
+			_mm256_storeu_ps(dst + w, pqInverseEotf(_mm256_loadu_ps(src + w)));
+		}
+		pqInverseEotfRange_c(dst, src, w, width);
+	}
+
+	void lmsToRgb_avx2(uint16_t* r, uint16_t* g, uint16_t* b, int width, const DoViLmsTables& tables)
+	{
+		const float* m = tables.lmsToRgb;
+		uint16_t* rgb[3] = { r, g, b };
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			__m256i res[3][2];
+			for (int half = 0; half < 2; half++) {
+				const int x = w + 8 * half;
+				__m256 lms[3];
+				for (int c = 0; c < 3; c++)
+					lms[c] = _mm256_i32gather_ps(tables.eotf, load8(rgb[c] + x), 4);
+				for (int c = 0; c < 3; c++) {
+					__m256 v = _mm256_fmadd_ps(_mm256_set1_ps(m[3 * c + 2]), lms[2],
+						_mm256_fmadd_ps(_mm256_set1_ps(m[3 * c + 1]), lms[1], _mm256_mul_ps(_mm256_set1_ps(m[3 * c]), lms[0])));
+					v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+					res[c][half] = _mm256_cvttps_epi32(_mm256_fmadd_ps(pqInverseEotf(v), _mm256_set1_ps(65535.0f), _mm256_set1_ps(0.5f)));
+				}
+			}
+			for (int c = 0; c < 3; c++)
+				store16(rgb[c] + w, res[c][0], res[c][1]);
+		}
+		lmsToRgbRange_c(r, g, b, w, width, tables);
+	}
+
+	inline __m256i dither16(const uint16_t* src, const uint16_t* thresholds, __m128i shift, __m256i outMax)
+	{
+		const __m256i x = _mm256_adds_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(thresholds)));
+		return _mm256_min_epu16(_mm256_srl_epi16(x, shift), outMax);
+	}
+
+	void dither16_avx2(uint16_t* dst, const uint16_t* src, int width, const uint16_t* thresholds, int shift, int outMax)
+	{
+		const __m128i shiftV = _mm_cvtsi32_si128(shift);
+		const __m256i outMaxV = _mm256_set1_epi16(static_cast<short>(outMax));
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), dither16(src + w, thresholds + (w & 63), shiftV, outMaxV));
+		}
+		dither16Range_c(dst, src, w, width, thresholds, shift, outMax);
+	}
+
+	void dither8_avx2(uint8_t* dst, const uint16_t* src, int width, const uint16_t* thresholds, int shift, int outMax)
+	{
+		const __m128i shiftV = _mm_cvtsi32_si128(shift);
+		const __m256i outMaxV = _mm256_set1_epi16(static_cast<short>(outMax));
+		int w = 0;
+		for (; w + 32 <= width; w += 32) {
+			const __m256i lo = dither16(src + w, thresholds + (w & 63), shiftV, outMaxV);
+			const __m256i hi = dither16(src + w + 16, thresholds + (w & 63) + 16, shiftV, outMaxV);
+			const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), packed);
+		}
+		dither8Range_c(dst, src, w, width, thresholds, shift, outMax);
+	}
+
+	void maxRgbStats_avx2(DoViRgbStats& stats, const uint16_t* r, const uint16_t* g, const uint16_t* b, int width)
+	{
+		// the sums of the low and the high bytes of the maxima in 64 bit lanes, they cannot overflow
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i lowBytes = _mm256_set1_epi16(0xFF);
+		__m256i sumLo = zero;
+		__m256i sumHi = zero;
+		__m256i minV = _mm256_set1_epi16(-1);
+		__m256i maxV = zero;
+		alignas(32) uint16_t bins[16];
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			const __m256i x = _mm256_max_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(r + w)),
+				_mm256_max_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(g + w)),
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + w))));
+			minV = _mm256_min_epu16(minV, x);
+			maxV = _mm256_max_epu16(maxV, x);
+			sumLo = _mm256_add_epi64(sumLo, _mm256_sad_epu8(_mm256_and_si256(x, lowBytes), zero));
+			sumHi = _mm256_add_epi64(sumHi, _mm256_sad_epu8(_mm256_srli_epi16(x, 8), zero));
+			// there is no scatter to count the bins with, colliding indices would need resolving anyway
+			_mm256_store_si256(reinterpret_cast<__m256i*>(bins), _mm256_srli_epi16(x, 10));
+			for (int i = 0; i < 16; i++)
+				stats.histogram[bins[i]]++;
+		}
+		alignas(32) uint16_t mins[16];
+		alignas(32) uint16_t maxs[16];
+		alignas(32) uint64_t sums[2][4];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(mins), minV);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(maxs), maxV);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(sums[0]), sumLo);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(sums[1]), sumHi);
+		for (int i = 0; i < 16; i++) {
+			stats.min = std::min<uint32_t>(stats.min, mins[i]);
+			stats.max = std::max<uint32_t>(stats.max, maxs[i]);
+		}
+		for (int i = 0; i < 4; i++)
+			stats.sum += sums[0][i] + (sums[1][i] << 8);
+		stats.count += w;
+		maxRgbStatsRange_c(stats, r, g, b, w, width);
+	}
+}
+
+void initKernelsAvx2(DoViKernels& kernels)
+{
+	kernels.upsampleLumaVert = upsampleLumaVert_avx2;
+	kernels.upsampleChromaVert = upsampleChromaVert_avx2;
+	kernels.upsampleLumaHorz = upsampleLumaHorz_avx2;
+	kernels.upsampleChromaHorz = upsampleChromaHorz_avx2;
+	kernels.upsampleLumaVertBilinear = upsampleLumaVertBilinear_avx2;
+	kernels.upsampleChromaVertBilinear = upsampleChromaVertBilinear_avx2;
+	kernels.upsampleLumaHorzBilinear = upsampleLumaHorzBilinear_avx2;
+	kernels.upsampleChromaHorzBilinear = upsampleChromaHorzBilinear_avx2;
+	kernels.ycc2rgb = ycc2rgb_avx2;
+	kernels.lmsToRgb = lmsToRgb_avx2;
+	kernels.reshape = reshape_avx2;
+	kernels.trimSaturation = trimSaturation_avx2;
+	kernels.replicate2x = replicate2x_avx2;
+	kernels.lookupFloat = lookupFloat_avx2;
+	kernels.lookup16 = lookup16_avx2;
+	kernels.pqEotf = pqEotf_avx2;
+	kernels.pqInverseEotf = pqInverseEotf_avx2;
+	kernels.dither16 = dither16_avx2;
+	kernels.dither8 = dither8_avx2;
+	kernels.maxRgbStats = maxRgbStats_avx2;
+}
+#endif
@@ -0,0 +1,478 @@
+#include <algorithm>
+#include <cfloat>
+
+#include "../DoViKernelsImpl.h"
+
+#ifdef DOVI_KERNELS_X86
+#include <immintrin.h>
+
+namespace {
+	// 16 samples widened to 32 bit, so the taps can be applied without overflow
+	inline __m512i load16(const uint16_t* p)
+	{
+		return _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+	}
+
+	inline __m512i mul(__m512i x, int c)
+	{
+		return _mm512_mullo_epi32(x, _mm512_set1_epi32(c));
+	}
+
+	// narrows 16 results to 16 samples, saturating to [0, 0xFFFF] like Clip3
+	inline void store16(uint16_t* p, __m512i x)
+	{
+		const __m256i packed = _mm512_cvtusepi32_epi16(_mm512_max_epi32(x, _mm512_setzero_si512()));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), packed);
+	}
+
+	// interleaves 16 even and 16 odd results to 32 consecutive samples
+	inline void storeInterleaved32(uint16_t* p, __m512i even, __m512i odd)
+	{
+		const __m512i packed = _mm512_packus_epi32(_mm512_unpacklo_epi32(even, odd), _mm512_unpackhi_epi32(even, odd));
+		_mm512_storeu_si512(p, packed);
+	}
+
+	// taps of DoViProcessor::upsampleLumaEven / upsampleLumaOdd on y[n - 2] .. y[n + 2]
+	inline __m512i lumaEven(__m512i ym2, __m512i ym1, __m512i y0, __m512i yp1)
+	{
+		__m512i sum = _mm512_add_epi32(mul(ym2, -3), mul(ym1, 29));
+		sum = _mm512_add_epi32(sum, _mm512_add_epi32(mul(y0, 111), mul(yp1, -9)));
+		return _mm512_srai_epi32(_mm512_add_epi32(sum, _mm512_set1_epi32(64)), 7);
+	}
+
+	inline __m512i lumaOdd(__m512i ym1, __m512i y0, __m512i yp1, __m512i yp2)
+	{
+		__m512i sum = _mm512_add_epi32(mul(ym1, -9), mul(y0, 111));
+		sum = _mm512_add_epi32(sum, _mm512_add_epi32(mul(yp1, 29), mul(yp2, -3)));
+		return _mm512_srai_epi32(_mm512_add_epi32(sum, _mm512_set1_epi32(64)), 7);
+	}
+
+	// taps of DoViProcessor::upsampleChromaOdd on y[n - 1] .. y[n + 2]
+	inline __m512i chromaOdd(__m512i ym1, __m512i y0, __m512i yp1, __m512i yp2)
+	{
+		const __m512i sum = _mm512_sub_epi32(mul(_mm512_add_epi32(y0, yp1), 2355), mul(_mm512_add_epi32(ym1, yp2), 307));
+		return _mm512_srai_epi32(_mm512_add_epi32(sum, _mm512_set1_epi32(2048)), 12);
+	}
+
+	// one output channel of the YCbCr to RGB matrix, before narrowing
+	inline __m512i matrixRow(__m512i yf, __m512i uf, __m512i vf, const int16_t* coef)
+	{
+		__m512i sum = _mm512_add_epi32(mul(yf, coef[0]), mul(uf, coef[1]));
+		sum = _mm512_add_epi32(sum, mul(vf, coef[2]));
+		return _mm512_srai_epi32(sum, 13);
+	}
+
+	void upsampleLumaVert_avx512(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			const __m512i res = odd
+				? lumaOdd(load16(src[1] + w), load16(src[2] + w), load16(src[3] + w), load16(src[4] + w))
+				: lumaEven(load16(src[0] + w), load16(src[1] + w), load16(src[2] + w), load16(src[3] + w));
+			store16(dst + w, res);
+		}
+		upsampleLumaVertRange_c(dst, src, w, width, odd);
+	}
+
+	void upsampleChromaVert_avx512(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		if (!odd) {
+			upsampleChromaVertRange_c(dst, src, 0, width, odd);
+			return;
+		}
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			store16(dst + w, chromaOdd(load16(src[0] + w), load16(src[1] + w), load16(src[2] + w), load16(src[3] + w)));
+		}
+		upsampleChromaVertRange_c(dst, src, w, width, odd);
+	}
+
+	void upsampleLumaHorz_avx512(uint16_t* dst, const uint16_t* src, int width)
+	{
+		// the vector loop covers the columns that need no clamping
+		int w = 2;
+		upsampleLumaHorzRange_c(dst, src, width, 0, std::min(w, width));
+		for (; w + 16 <= width - 2; w += 16) {
+			const __m512i ym2 = load16(src + w - 2);
+			const __m512i ym1 = load16(src + w - 1);
+			const __m512i y0 = load16(src + w);
+			const __m512i yp1 = load16(src + w + 1);
+			const __m512i yp2 = load16(src + w + 2);
+			storeInterleaved32(dst + 2 * w, lumaEven(ym2, ym1, y0, yp1), lumaOdd(ym1, y0, yp1, yp2));
+		}
+		upsampleLumaHorzRange_c(dst, src, width, std::min(w, width), width);
+	}
+
+	void upsampleChromaHorz_avx512(uint16_t* dst, const uint16_t* src, int width)
+	{
+		int w = 1;
+		upsampleChromaHorzRange_c(dst, src, width, 0, std::min(w, width));
+		for (; w + 16 <= width - 2; w += 16) {
+			const __m512i ym1 = load16(src + w - 1);
+			const __m512i y0 = load16(src + w);
+			const __m512i yp1 = load16(src + w + 1);
+			const __m512i yp2 = load16(src + w + 2);
+			storeInterleaved32(dst + 2 * w, y0, chromaOdd(ym1, y0, yp1, yp2));
+		}
+		upsampleChromaHorzRange_c(dst, src, width, std::min(w, width), width);
+	}
+
+	// (a + b) >> 1, the average instruction rounds up
+	inline __m512i avgFloor(__m512i a, __m512i b)
+	{
+		return _mm512_sub_epi16(_mm512_avg_epu16(a, b), _mm512_and_si512(_mm512_xor_si512(a, b), _mm512_set1_epi16(1)));
+	}
+
+	// (a + 3 * b + 2) >> 2 without widening, equal to (((a + b) >> 1) + b + 1) >> 1
+	inline __m512i quarterBlend(__m512i a, __m512i b)
+	{
+		return _mm512_avg_epu16(b, avgFloor(a, b));
+	}
+
+	// interleaves 32 even and 32 odd samples to 64 consecutive samples
+	inline void storeInterleavedWords(uint16_t* p, __m512i even, __m512i odd)
+	{
+		// the unpacks work per 128 bit lane, the permutes bring the lanes back in order
+		const __m512i lo = _mm512_unpacklo_epi16(even, odd);
+		const __m512i hi = _mm512_unpackhi_epi16(even, odd);
+		_mm512_storeu_si512(p, _mm512_permutex2var_epi64(lo, _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0), hi));
+		_mm512_storeu_si512(p + 32, _mm512_permutex2var_epi64(lo, _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4), hi));
+	}
+
+	void upsampleLumaVertBilinear_avx512(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		const uint16_t* outer = odd ? src[3] : src[1];
+		int w = 0;
+		for (; w + 32 <= width; w += 32) {
+			_mm512_storeu_si512(dst + w, quarterBlend(_mm512_loadu_si512(outer + w), _mm512_loadu_si512(src[2] + w)));
+		}
+		upsampleLumaVertBilinearRange_c(dst, src, w, width, odd);
+	}
+
+	void upsampleChromaVertBilinear_avx512(uint16_t* dst, const uint16_t* const* src, int width, bool odd)
+	{
+		if (!odd) {
+			upsampleChromaVertBilinearRange_c(dst, src, 0, width, odd);
+			return;
+		}
+		int w = 0;
+		for (; w + 32 <= width; w += 32) {
+			_mm512_storeu_si512(dst + w, _mm512_avg_epu16(_mm512_loadu_si512(src[1] + w), _mm512_loadu_si512(src[2] + w)));
+		}
+		upsampleChromaVertBilinearRange_c(dst, src, w, width, odd);
+	}
+
+	void upsampleLumaHorzBilinear_avx512(uint16_t* dst, const uint16_t* src, int width)
+	{
+		int w = 1;
+		upsampleLumaHorzBilinearRange_c(dst, src, width, 0, std::min(w, width));
+		for (; w + 32 <= width - 1; w += 32) {
+			const __m512i y0 = _mm512_loadu_si512(src + w);
+			storeInterleavedWords(dst + 2 * w, quarterBlend(_mm512_loadu_si512(src + w - 1), y0),
+				quarterBlend(_mm512_loadu_si512(src + w + 1), y0));
+		}
+		upsampleLumaHorzBilinearRange_c(dst, src, width, std::min(w, width), width);
+	}
+
+	void upsampleChromaHorzBilinear_avx512(uint16_t* dst, const uint16_t* src, int width)
+	{
+		int w = 0;
+		for (; w + 32 <= width - 1; w += 32) {
+			const __m512i y0 = _mm512_loadu_si512(src + w);
+			storeInterleavedWords(dst + 2 * w, y0, _mm512_avg_epu16(y0, _mm512_loadu_si512(src + w + 1)));
+		}
+		upsampleChromaHorzBilinearRange_c(dst, src, width, w, width);
+	}
+
+	void ycc2rgb_avx512(uint16_t* r, uint16_t* g, uint16_t* b, const uint16_t* y, const uint16_t* u, const uint16_t* v,
+		int width, const int16_t* coef, const uint32_t* offset)
+	{
+		const __m512i offY = _mm512_set1_epi32(static_cast<int>(offset[0]));
+		const __m512i offU = _mm512_set1_epi32(static_cast<int>(offset[1]));
+		const __m512i offV = _mm512_set1_epi32(static_cast<int>(offset[2]));
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			const __m512i yf = _mm512_sub_epi32(load16(y + w), offY);
+			const __m512i uf = _mm512_sub_epi32(load16(u + w), offU);
+			const __m512i vf = _mm512_sub_epi32(load16(v + w), offV);
+			store16(r + w, matrixRow(yf, uf, vf, coef));
+			store16(g + w, matrixRow(yf, uf, vf, coef + 3));
+			store16(b + w, matrixRow(yf, uf, vf, coef + 6));
+		}
+		ycc2rgbRange_c(r, g, b, y, u, v, w, width, coef, offset);
+	}
+
+	// looks up 16 samples shifted to table indices, clamped to the table size
+	inline __m512i lookup16(const int32_t* table, const uint16_t* p, __m128i shift, __m512i maxIndex)
+	{
+		const __m512i idx = _mm512_min_epi32(_mm512_srl_epi32(load16(p), shift), maxIndex);
+		return _mm512_i32gather_epi32(idx, table, 4);
+	}
+
+	void reshape_avx512(uint16_t* dst, const uint16_t* bl, const uint16_t* el, int width, const DoViReshapeTables& tables)
+	{
+		const __m128i blShift = _mm_cvtsi32_si128(tables.blShift);
+		const __m128i elShift = _mm_cvtsi32_si128(tables.elShift);
+		const __m128i outShift = _mm_cvtsi32_si128(tables.outShift);
+		const __m512i blMaxIndex = _mm512_set1_epi32(tables.blMaxIndex);
+		const __m512i elMaxIndex = _mm512_set1_epi32(tables.elMaxIndex);
+		const __m512i outMax = _mm512_set1_epi32(tables.outMax);
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			__m512i h = lookup16(tables.blMapping, bl + w, blShift, blMaxIndex);
+			if (tables.elResidual)
+				h = _mm512_add_epi32(h, lookup16(tables.elResidual, el + w, elShift, elMaxIndex));
+			h = _mm512_min_epi32(_mm512_sra_epi32(h, outShift), outMax);
+			store16(dst + w, _mm512_sll_epi32(_mm512_max_epi32(h, _mm512_setzero_si512()), outShift));
+		}
+		reshapeRange_c(dst, bl, el, w, width, tables);
+	}
+
+	// same operations as log2Approx / exp2Approx of the portable kernels
+	inline __m512 log2Approx(__m512 x)
+	{
+		const __m512i bits = _mm512_castps_si512(x);
+		__m512 e = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(127)));
+		__m512 m = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x7FFFFF)), _mm512_set1_epi32(0x3F800000)));
+		const __mmask16 big = _mm512_cmp_ps_mask(m, _mm512_set1_ps(1.41421356f), _CMP_GT_OQ);
+		m = _mm512_mask_mul_ps(m, big, m, _mm512_set1_ps(0.5f));
+		e = _mm512_mask_add_ps(e, big, e, _mm512_set1_ps(1.0f));
+		const __m512 one = _mm512_set1_ps(1.0f);
+		const __m512 t = _mm512_div_ps(_mm512_sub_ps(m, one), _mm512_add_ps(m, one));
+		const __m512 t2 = _mm512_mul_ps(t, t);
+		__m512 p = _mm512_fmadd_ps(_mm512_set1_ps(kLog2Coef[4]), t2, _mm512_set1_ps(kLog2Coef[3]));
+		p = _mm512_fmadd_ps(p, t2, _mm512_set1_ps(kLog2Coef[2]));
+		p = _mm512_fmadd_ps(p, t2, _mm512_set1_ps(kLog2Coef[1]));
+		p = _mm512_fmadd_ps(p, t2, _mm512_set1_ps(kLog2Coef[0]));
+		return _mm512_fmadd_ps(p, t, e);
+	}
+
+	inline __m512 exp2Approx(__m512 y)
+	{
+		y = _mm512_min_ps(_mm512_max_ps(y, _mm512_set1_ps(-126.0f)), _mm512_set1_ps(127.0f));
+		const __m512 n = _mm512_roundscale_ps(y, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		const __m512 f = _mm512_sub_ps(y, n);
+		__m512 p = _mm512_set1_ps(kExp2Coef[7]);
+		for (int i = 6; i >= 0; i--)
+			p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(kExp2Coef[i]));
+		const __m512i sbits = _mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23);
+		return _mm512_mul_ps(p, _mm512_castsi512_ps(sbits));
+	}
+
+	// same as powApprox of the portable kernels
+	inline __m512 powApprox(__m512 x, float p)
+	{
+		const __mmask16 positive = _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GT_OQ);
+		x = _mm512_max_ps(x, _mm512_set1_ps(FLT_MIN));
+		return _mm512_maskz_mov_ps(positive, exp2Approx(_mm512_mul_ps(_mm512_set1_ps(p), log2Approx(x))));
+	}
+
+	inline __m512i nitsToPq(const float* thresholds, __m512 nits)
+	{
+		__m512i idx = _mm512_setzero_si512();
+		for (int step = 2048; step > 0; step >>= 1) {
+			const __m512i stepV = _mm512_set1_epi32(step);
+			const __m512 th = _mm512_i32gather_ps(_mm512_add_epi32(idx, stepV), thresholds, 4);
+			idx = _mm512_mask_add_epi32(idx, _mm512_cmp_ps_mask(th, nits, _CMP_LE_OQ), idx, stepV);
+		}
+		return idx;
+	}
+
+	void trimSaturation_avx512(uint16_t* r, uint16_t* g, uint16_t* b, int width, const DoViTrimTables& tables)
+	{
+		const __m128i inShift = _mm_cvtsi32_si128(tables.inShift);
+		const __m128i outShift = _mm_cvtsi32_si128(tables.outShift);
+		uint16_t* rgb[3] = { r, g, b };
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			__m512 f[3];
+			for (int c = 0; c < 3; c++)
+				f[c] = _mm512_i32gather_ps(_mm512_srl_epi32(load16(rgb[c] + w), inShift), tables.tone, 4);
+			const __m512 y = _mm512_fmadd_ps(_mm512_set1_ps(kTrimLumaWeight[2]), f[2],
+				_mm512_fmadd_ps(_mm512_set1_ps(kTrimLumaWeight[1]), f[1], _mm512_mul_ps(_mm512_set1_ps(kTrimLumaWeight[0]), f[0])));
+			for (int c = 0; c < 3; c++) {
+				const __m512 x = _mm512_div_ps(_mm512_mul_ps(_mm512_set1_ps(tables.chromaWeight), f[c]), y);
+				const __m512 gain = exp2Approx(_mm512_mul_ps(_mm512_set1_ps(tables.saturationGain), log2Approx(x)));
+				const __m512i code = _mm512_sll_epi32(nitsToPq(tables.pqThresholds, _mm512_mul_ps(f[c], gain)), outShift);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(rgb[c] + w), _mm512_cvtepi32_epi16(code));
+			}
+		}
+		trimSaturationRange_c(r, g, b, w, width, tables);
+	}
+
+	void replicate2x_avx512(uint16_t* dst, const uint16_t* src, int width)
+	{
+		// word indices 0, 0, 1, 1, ... for the lower and 16, 16, 17, 17, ... for the upper half
+		alignas(64) static const uint16_t order[2][32] = {
+			{ 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15 },
+			{ 16, 16, 17, 17, 18, 18, 19, 19, 20, 20, 21, 21, 22, 22, 23, 23, 24, 24, 25, 25, 26, 26, 27, 27, 28, 28, 29, 29, 30, 30, 31, 31 },
+		};
+		const __m512i lo = _mm512_load_si512(order[0]);
+		const __m512i hi = _mm512_load_si512(order[1]);
+		int w = 0;
+		for (; w + 32 <= width; w += 32) {
+			const __m512i x = _mm512_loadu_si512(src + w);
+			_mm512_storeu_si512(dst + 2 * w, _mm512_permutexvar_epi16(lo, x));
+			_mm512_storeu_si512(dst + 2 * w + 32, _mm512_permutexvar_epi16(hi, x));
+		}
+		replicate2xRange_c(dst, src, w, width);
+	}
+
+	void lookupFloat_avx512(float* dst, const uint16_t* src, int width, const float* table)
+	{
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			_mm512_storeu_ps(dst + w, _mm512_i32gather_ps(load16(src + w), table, 4));
+		}
+		lookupFloatRange_c(dst, src, w, width, table);
+	}
+
+	void lookup16_avx512(uint16_t* dst, const uint16_t* src, int width, const uint16_t* table)
+	{
+		// 32 bit gathers at 2 byte steps, the truncation drops the next entry or the padding
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			const __m512i x = _mm512_i32gather_epi32(load16(src + w), table, 2);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), _mm512_cvtepi32_epi16(x));
+		}
+		lookup16Range_c(dst, src, w, width, table);
+	}
+
+	void pqEotf_avx512(float* dst, const float* src, int width)
+	{
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			const __m512 epower = powApprox(_mm512_loadu_ps(src + w), 1 / DoViPqMath::m2);
+			const __m512 num = _mm512_max_ps(_mm512_sub_ps(epower, _mm512_set1_ps(DoViPqMath::c1)), _mm512_setzero_ps());
+			const __m512 denom = _mm512_fnmadd_ps(_mm512_set1_ps(DoViPqMath::c3), epower, _mm512_set1_ps(DoViPqMath::c2));
+			_mm512_storeu_ps(dst + w, powApprox(_mm512_div_ps(num, denom), 1 / DoViPqMath::m1));
+		}
+		pqEotfRange_c(dst, src, w, width);
+	}
+
+	inline __m512 pqInverseEotf(__m512 y)
+	{
+		const __m512 epower = powApprox(y, DoViPqMath::m1);
+		const __m512 num = _mm512_fmadd_ps(_mm512_set1_ps(DoViPqMath::c2), epower, _mm512_set1_ps(DoViPqMath::c1));
+		const __m512 denom = _mm512_fmadd_ps(_mm512_set1_ps(DoViPqMath::c3), epower, _mm512_set1_ps(1.0f));
+		return powApprox(_mm512_div_ps(num, denom), DoViPqMath::m2);
+	}
+
+	void pqInverseEotf_avx512(float* dst, const float* src, int width)
+	{
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			_mm512_storeu_ps(dst + w, pqInverseEotf(_mm512_loadu_ps(src + w)));
+		}
+		pqInverseEotfRange_c(dst, src, w, width);
+	}
+
+	void lmsToRgb_avx512(uint16_t* r, uint16_t* g, uint16_t* b, int width, const DoViLmsTables& tables)
+	{
+		const float* m = tables.lmsToRgb;
+		uint16_t* rgb[3] = { r, g, b };
+		int w = 0;
+		for (; w + 16 <= width; w += 16) {
+			__m512 lms[3];
+			for (int c = 0; c < 3; c++)
+				lms[c] = _mm512_i32gather_ps(load16(rgb[c] + w), tables.eotf, 4);
+			for (int c = 0; c < 3; c++) {
+				__m512 v = _mm512_fmadd_ps(_mm512_set1_ps(m[3 * c + 2]), lms[2],
+					_mm512_fmadd_ps(_mm512_set1_ps(m[3 * c + 1]), lms[1], _mm512_mul_ps(_mm512_set1_ps(m[3 * c]), lms[0])));
+				v = _mm512_min_ps(_mm512_max_ps(v, _mm512_setzero_ps()), _mm512_set1_ps(1.0f));
+				store16(rgb[c] + w, _mm512_cvttps_epi32(_mm512_fmadd_ps(pqInverseEotf(v), _mm512_set1_ps(65535.0f), _mm512_set1_ps(0.5f))));
+			}
+		}
+		lmsToRgbRange_c(r, g, b, w, width, tables);
+	}
+
+	inline __m512i dither32(const uint16_t* src, const uint16_t* thresholds, __m128i shift, __m512i outMax)
+	{
+		const __m512i x = _mm512_adds_epu16(_mm512_loadu_si512(src), _mm512_loadu_si512(thresholds));
+		return _mm512_min_epu16(_mm512_srl_epi16(x, shift), outMax);
+	}
+
+	void dither16_avx512(uint16_t* dst, const uint16_t* src, int width, const uint16_t* thresholds, int shift, int outMax)
+	{
+		const __m128i shiftV = _mm_cvtsi32_si128(shift);
+		const __m512i outMaxV = _mm512_set1_epi16(static_cast<short>(outMax));
+		int w = 0;
+		for (; w + 32 <= width; w += 32) {
+			_mm512_storeu_si512(dst + w, dither32(src + w, thresholds + (w & 63), shiftV, outMaxV));
+		}
+		dither16Range_c(dst, src, w, width, thresholds, shift, outMax);
+	}
+
+	void dither8_avx512(uint8_t* dst, const uint16_t* src, int width, const uint16_t* thresholds, int shift, int outMax)
+	{
+		const __m128i shiftV = _mm_cvtsi32_si128(shift);
+		const __m512i outMaxV = _mm512_set1_epi16(static_cast<short>(outMax));
+		int w = 0;
+		for (; w + 32 <= width; w += 32) {
+			const __m512i x = dither32(src + w, thresholds + (w & 63), shiftV, outMaxV);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), _mm512_cvtepi16_epi8(x));
+		}
+		dither8Range_c(dst, src, w, width, thresholds, shift, outMax);
+	}
+
+	void maxRgbStats_avx512(DoViRgbStats& stats, const uint16_t* r, const uint16_t* g, const uint16_t* b, int width)
+	{
+		// the sums of the low and the high bytes of the maxima in 64 bit lanes, they cannot overflow
+		const __m512i zero = _mm512_setzero_si512();
+		const __m512i lowBytes = _mm512_set1_epi16(0xFF);
+		__m512i sumLo = zero;
+		__m512i sumHi = zero;
+		__m512i minV = _mm512_set1_epi16(-1);
+		__m512i maxV = zero;
+		alignas(64) uint16_t bins[32];
+		int w = 0;
+		for (; w + 32 <= width; w += 32) {
+			const __m512i x = _mm512_max_epu16(_mm512_loadu_si512(r + w),
+				_mm512_max_epu16(_mm512_loadu_si512(g + w), _mm512_loadu_si512(b + w)));
+			minV = _mm512_min_epu16(minV, x);
+			maxV = _mm512_max_epu16(maxV, x);
+			sumLo = _mm512_add_epi64(sumLo, _mm512_sad_epu8(_mm512_and_si512(x, lowBytes), zero));
+			sumHi = _mm512_add_epi64(sumHi, _mm512_sad_epu8(_mm512_srli_epi16(x, 8), zero));
+			// colliding indices of a conflict free scatter would cost more than counting the bins one by one
+			_mm512_store_si512(bins, _mm512_srli_epi16(x, 10));
+			for (int i = 0; i < 32; i++)
+				stats.histogram[bins[i]]++;
+		}
+		alignas(64) uint16_t mins[32];
+		alignas(64) uint16_t maxs[32];
+		_mm512_store_si512(mins, minV);
+		_mm512_store_si512(maxs, maxV);
+		for (int i = 0; i < 32; i++) {
+			stats.min = std::min<uint32_t>(stats.min, mins[i]);
+			stats.max = std::max<uint32_t>(stats.max, maxs[i]);
+		}
+		stats.sum += _mm512_reduce_add_epi64(_mm512_add_epi64(sumLo, _mm512_slli_epi64(sumHi, 8)));
+		stats.count += w;
+		maxRgbStatsRange_c(stats, r, g, b, w, width);
+	}
+}
+
+void initKernelsAvx512(DoViKernels& kernels)
+{
+	kernels.upsampleLumaVert = upsampleLumaVert_avx512;
+	kernels.upsampleChromaVert = upsampleChromaVert_avx512;
+	kernels.upsampleLumaHorz = upsampleLumaHorz_avx512;
+	kernels.upsampleChromaHorz = upsampleChromaHorz_avx512;
+	kernels.upsampleLumaVertBilinear = upsampleLumaVertBilinear_avx512;
+	kernels.upsampleChromaVertBilinear = upsampleChromaVertBilinear_avx512;
+	kernels.upsampleLumaHorzBilinear = upsampleLumaHorzBilinear_avx512;
+	kernels.upsampleChromaHorzBilinear = upsampleChromaHorzBilinear_avx512;
+	kernels.ycc2rgb = ycc2rgb_avx512;
+	kernels.lmsToRgb = lmsToRgb_avx512;
+	kernels.reshape = reshape_avx512;
+	kernels.trimSaturation = trimSaturation_avx512;
+	kernels.replicate2x = replicate2x_avx512;
+	kernels.lookupFloat = lookupFloat_avx512;
+	kernels.lookup16 = lookup16_avx512;
+	kernels.pqEotf = pqEotf_avx512;
+	kernels.pqInverseEotf = pqInverseEotf_avx512;
+	kernels.dither16 = dither16_avx512;
+	kernels.dither8 = dither8_avx512;
+	kernels.maxRgbStats = maxRgbStats_avx512;
+}
+#endif